@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Project created by QtCreator 2023-12-03T14:17:15
+#
+#-------------------------------------------------
+
+QT       += core gui svg qml xml
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++11 file_copies
+
+COPIES += samplesvg
+
+samplesvg.files = $$files($$PWD/../sample.svg)
+samplesvg.path = $$OUT_PWD
+
+TARGET = parametricsvg
+TEMPLATE = app
+
+
+SOURCES += main.cpp\
+        mainwindow.cpp
+
+HEADERS  += mainwindow.h
+
+include(../parametricsvgitem/parametricsvgitem.pri)
+
+FORMS    += mainwindow.ui
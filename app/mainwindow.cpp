@@ -14,13 +14,12 @@ MainWindow::MainWindow(QWidget *parent) :
 
     m_psvg = new ParametricSvgItem("sample.svg");
 
+    //Все ошибки загрузки в одном окне
     if(m_psvg->isError()){
-        foreach(auto message, m_psvg->errors()){
-            QMessageBox msgBox;
-            msgBox.setText(message);
-            msgBox.setWindowTitle("JS");
-            msgBox.exec();
-        }
+        QMessageBox msgBox;
+        msgBox.setText(m_psvg->errors().join("\n"));
+        msgBox.setWindowTitle("JS");
+        msgBox.exec();
     }
 
     ui->graphicsView->scene()->addItem(m_psvg);
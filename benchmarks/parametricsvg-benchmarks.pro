@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Benchmarks of parametric SVG loading, evaluation and painting
+#
+#-------------------------------------------------
+
+QT       += core gui testlib
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = parametricsvg-benchmarks
+TEMPLATE = app
+
+DEFINES += SAMPLE_SVG=\\\"$$PWD/../sample.svg\\\"
+
+SOURCES += tst_parametricsvgbenchmark.cpp
+
+include(../parametricsvgitem/parametricsvgitem.pri)
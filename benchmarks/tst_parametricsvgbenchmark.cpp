@@ -0,0 +1,367 @@
+/*!
+ * Benchmarks of loading, evaluation, redraw and painting of parametric SVG.
+ *
+ * Results are printed by QtTest, e.g. as XML:
+ * parametricsvg-benchmarks -o results.xml,xml
+ */
+#include "parametricsvgdocument.h"
+#include "parametricsvgitem.h"
+
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QtTest>
+
+class ParametricSvgBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    QTemporaryDir m_dir;
+    //Имя набора данных -> путь к SVG
+    QList<QPair<QString, QString> > m_files;
+
+
+    //методы
+    void addFileColumns();
+    QString writeSyntheticSvg(const QString &name, int elements, int attributes, int expressions, int depth);
+    static QString firstNumberParameter(const ParametricSvgDocument &document);
+    static qint64 residentBytes(const QString &field);
+    static bool resetPeakResidentBytes();
+
+private slots:
+    void initTestCase();
+
+    void loadTemplate_data();
+    void loadTemplate();
+    void evaluateAll_data();
+    void evaluateAll();
+    void updateParameter_data();
+    void updateParameter();
+    void serialize_data();
+    void serialize();
+    void batchThroughput_data();
+    void batchThroughput();
+    void redraw_data();
+    void redraw();
+    void paint_data();
+    void paint();
+    void peakMemory_data();
+    void peakMemory();
+};
+
+void ParametricSvgBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    QVERIFY(QFile::exists(SAMPLE_SVG));
+
+    m_files.append(qMakePair(QString("sample"), QString(SAMPLE_SVG)));
+    m_files.append(qMakePair(QString("flat"), writeSyntheticSvg("flat", 1000, 2, 10, 1)));
+    m_files.append(qMakePair(QString("attributes"), writeSyntheticSvg("attributes", 1000, 5, 10, 1)));
+    m_files.append(qMakePair(QString("expressions"), writeSyntheticSvg("expressions", 100, 2, 1000, 1)));
+    m_files.append(qMakePair(QString("deep"), writeSyntheticSvg("deep", 500, 2, 10, 100)));
+}
+
+/*!
+  * Generate parametric SVG with 8 parameters
+  *
+  * \param[in] name file name without extension
+  * \param[in] elements number of rect elements
+  * \param[in] attributes number of parametric attributes of each element (1..5)
+  * \param[in] expressions number of expressions
+  * \param[in] depth nesting level of groups
+  * \return path to the file
+  */
+QString ParametricSvgBenchmark::writeSyntheticSvg(const QString &name, int elements, int attributes, int expressions, int depth)
+{
+    static const char *attributeNames[] = { "x", "y", "width", "height", "rx" };
+    const int parameters = 8;
+
+    const QString fname = m_dir.filePath(name + ".svg");
+    QFile file(fname);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
+        return QString();
+    }
+
+    QTextStream out(&file);
+    out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        << "<svg viewBox=\"0 0 1000 1000\" xmlns=\"http://www.w3.org/2000/svg\""
+        << " xmlns:parametric=\"https://parametric/v1.0\">\n"
+        << "  <defs>\n";
+    for (int i = 0; i < parameters; ++i) {
+        out << "    <parametric:default param=\"P" << i << "\" value=\"" << 10 + i << "\" min=\"0\" max=\"1000\"/>\n";
+    }
+    for (int i = 0; i < expressions; ++i) {
+        out << "    <parametric:expression var=\"E" << i << "\" exp=\"P" << i % parameters
+            << " * " << i + 1 << " / 10\"/>\n";
+    }
+    out << "  </defs>\n";
+
+    for (int i = 0; i < depth; ++i) {
+        out << "<g transform=\"translate(1, 1)\">\n";
+    }
+    for (int i = 0; i < elements; ++i) {
+        out << "  <rect x=\"0\" y=\"0\" width=\"10\" height=\"10\" rx=\"1\" style=\"fill: rgb(249, 164, 74);\"";
+        for (int j = 0; j < qBound(1, attributes, 5); ++j) {
+            out << " parametric:" << attributeNames[j] << "=\"`${E" << (i + j) % expressions << " + " << j << "}`\"";
+        }
+        out << "/>\n";
+    }
+    for (int i = 0; i < depth; ++i) {
+        out << "</g>\n";
+    }
+    out << "</svg>\n";
+
+    return fname;
+}
+
+void ParametricSvgBenchmark::addFileColumns()
+{
+    QTest::addColumn<QString>("fileName");
+    for (int i = 0; i < m_files.size(); ++i) {
+        QTest::newRow(qPrintable(m_files.at(i).first)) << m_files.at(i).second;
+    }
+}
+
+/*!
+  * Find parameter to change in update benchmarks
+  *
+  * \param[in] document loaded document
+  * \return name of the first number parameter
+  */
+QString ParametricSvgBenchmark::firstNumberParameter(const ParametricSvgDocument &document)
+{
+    foreach (const QString &name, document.parameterNames()) {
+        if(document.parameterType(name) == QVariant::Double){
+            return name;
+        }
+    }
+    return QString();
+}
+
+/*!
+  * Get resident memory of the process
+  *
+  * \param[in] field field of /proc/self/status: VmRSS or VmHWM (peak)
+  * \return bytes. -1, if it is not available
+  */
+qint64 ParametricSvgBenchmark::residentBytes(const QString &field)
+{
+    QFile status("/proc/self/status");
+    if(!status.open(QIODevice::ReadOnly | QIODevice::Text)){
+        return -1;
+    }
+    QTextStream in(&status);
+    QString line;
+    const QString prefix = field + ':';
+    while (in.readLineInto(&line)) {
+        if(line.startsWith(prefix)){
+            //VmHWM:     12345 kB
+            return line.mid(prefix.size()).trimmed().section(' ', 0, 0).toLongLong() * 1024;
+        }
+    }
+    return -1;
+}
+
+/*!
+  * Reset peak resident memory of the process to the current value
+  *
+  * \return true, if the kernel supports it (Linux 4.0+)
+  */
+bool ParametricSvgBenchmark::resetPeakResidentBytes()
+{
+    QFile clearRefs("/proc/self/clear_refs");
+    if(!clearRefs.open(QIODevice::WriteOnly | QIODevice::Unbuffered)){
+        return false;
+    }
+    return clearRefs.write("5") == 1;
+}
+
+void ParametricSvgBenchmark::loadTemplate_data()
+{
+    addFileColumns();
+}
+
+void ParametricSvgBenchmark::loadTemplate()
+{
+    QFETCH(QString, fileName);
+
+    //Шаблон освобождается вместе с документом, поэтому файл разбирается каждый раз
+    QBENCHMARK {
+        ParametricSvgDocument document;
+        QVERIFY(document.setContent(fileName));
+    }
+}
+
+void ParametricSvgBenchmark::evaluateAll_data()
+{
+    addFileColumns();
+}
+
+void ParametricSvgBenchmark::evaluateAll()
+{
+    QFETCH(QString, fileName);
+    ParametricSvgDocument document;
+    QVERIFY(document.setContent(fileName));
+
+    QBENCHMARK {
+        document.evaluateAll();
+    }
+    QVERIFY(!document.isError());
+}
+
+void ParametricSvgBenchmark::updateParameter_data()
+{
+    addFileColumns();
+}
+
+void ParametricSvgBenchmark::updateParameter()
+{
+    QFETCH(QString, fileName);
+    ParametricSvgDocument document;
+    QVERIFY(document.setContent(fileName));
+    const QString name = firstNumberParameter(document);
+    QVERIFY(!name.isEmpty());
+    const double value = document.parameterValue(name).toDouble();
+
+    int i = 0;
+    QBENCHMARK {
+        document.setParameter(name, value + (++i % 2));
+        document.evaluateChanged();
+        document.toSvg();
+    }
+}
+
+void ParametricSvgBenchmark::serialize_data()
+{
+    addFileColumns();
+}
+
+void ParametricSvgBenchmark::serialize()
+{
+    QFETCH(QString, fileName);
+    ParametricSvgDocument document;
+    QVERIFY(document.setContent(fileName));
+
+    QBENCHMARK {
+        document.toSvg();
+    }
+}
+
+void ParametricSvgBenchmark::batchThroughput_data()
+{
+    addFileColumns();
+}
+
+/*!
+  * Time to evaluate and serialize 1000 parameter sets, as the batch renderer does
+  */
+void ParametricSvgBenchmark::batchThroughput()
+{
+    QFETCH(QString, fileName);
+    ParametricSvgDocument document;
+    QVERIFY(document.setContent(fileName));
+    const QStringList names = document.parameterNames();
+
+    QBENCHMARK {
+        for (int row = 0; row < 1000; ++row) {
+            document.resetParameters();
+            foreach (const QString &name, names) {
+                if(document.parameterType(name) == QVariant::Double){
+                    document.setParameter(name, (row * 7) % 100);
+                }
+            }
+            document.evaluateChanged();
+            document.toSvg();
+        }
+    }
+}
+
+void ParametricSvgBenchmark::redraw_data()
+{
+    addFileColumns();
+}
+
+/*!
+  * Single parameter update of the item: evaluation, serialization and loading of the renderer
+  */
+void ParametricSvgBenchmark::redraw()
+{
+    QFETCH(QString, fileName);
+    ParametricSvgItem item(fileName);
+    QVERIFY(!item.parameterNames().isEmpty());
+
+    QString name;
+    foreach (const QString &parameter, item.parameterNames()) {
+        if(item.parameterType(parameter) == QVariant::Double){
+            name = parameter;
+            break;
+        }
+    }
+    QVERIFY(!name.isEmpty());
+    const double value = item.parameterValue(name).toDouble();
+
+    int i = 0;
+    QBENCHMARK {
+        item.updateByParameter(name, value + (++i % 2));
+    }
+}
+
+void ParametricSvgBenchmark::paint_data()
+{
+    addFileColumns();
+}
+
+void ParametricSvgBenchmark::paint()
+{
+    QFETCH(QString, fileName);
+    ParametricSvgItem item(fileName);
+    QSize size = item.boundingRect().size().toSize();
+    QVERIFY(!size.isEmpty());
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    QStyleOptionGraphicsItem option;
+    option.rect = item.boundingRect().toRect();
+
+    QBENCHMARK {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        item.paint(&painter, &option);
+    }
+}
+
+void ParametricSvgBenchmark::peakMemory_data()
+{
+    addFileColumns();
+}
+
+/*!
+  * Peak resident memory used to load and evaluate 100 documents
+  * of the data set, measured from the baseline at the start of the row
+  */
+void ParametricSvgBenchmark::peakMemory()
+{
+    QFETCH(QString, fileName);
+    //Пик процесса монотонен, поэтому без сброса строки влияют друг на друга
+    if(!resetPeakResidentBytes()){
+        QSKIP("Peak memory reset is available only on Linux 4.0+");
+    }
+    const qint64 baseline = residentBytes("VmRSS");
+    QVERIFY(baseline >= 0);
+
+    QList<QSharedPointer<ParametricSvgDocument> > documents;
+    for (int i = 0; i < 100; ++i) {
+        QSharedPointer<ParametricSvgDocument> document(new ParametricSvgDocument());
+        QVERIFY(document->setContent(fileName));
+        document->toSvg();
+        documents.append(document);
+    }
+
+    QTest::setBenchmarkResult(qMax<qint64>(0, residentBytes("VmHWM") - baseline), QTest::BytesAllocated);
+}
+
+QTEST_MAIN(ParametricSvgBenchmark)
+
+#include "tst_parametricsvgbenchmark.moc"
@@ -1,29 +1,18 @@
 #-------------------------------------------------
 #
-# Project created by QtCreator 2023-12-03T14:17:15
+# Demo application, tools, tests and benchmarks
+# of parametric SVG. qmake && make && make check
 #
 #-------------------------------------------------
 
-QT       += core gui svg qml xml
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+SUBDIRS += \
+    app \
+    tools/parametricsvg-batch \
+    tools/parametricsvg-compile \
+    tests \
+    benchmarks
 
-CONFIG += c++11 file_copies
-
-COPIES += samplesvg
-
-samplesvg.files = $$files(sample.svg)
-samplesvg.path = $$OUT_PWD
-
-TARGET = parametricsvg
-TEMPLATE = app
-
-
-SOURCES += main.cpp\
-        mainwindow.cpp \
-    parametricsvgitem/parametricsvgitem.cpp
-
-HEADERS  += mainwindow.h \
-    parametricsvgitem/parametricsvgitem.h
-
-FORMS    += mainwindow.ui
+tests.file = tests/parametricsvg-tests.pro
+benchmarks.file = benchmarks/parametricsvg-benchmarks.pro
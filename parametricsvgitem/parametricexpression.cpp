@@ -0,0 +1,1036 @@
+/*!
+ * \class ParametricExpression
+ * Native evaluator for the arithmetic subset of JavaScript used in parametric SVG:
+ * numbers, strings, template literals, arithmetic, comparison, logical and
+ * conditional operators, and Math functions. Sources outside the subset are
+ * rejected by compile() and must be evaluated by QJSEngine.
+ */
+#include "parametricexpression.h"
+#include <QLocale>
+#include <QVarLengthArray>
+#include <qmath.h>
+#include <cmath>
+#include <limits>
+
+ParametricExpression::Value::Value():
+    type(Undefined),
+    number(0.0)
+{
+}
+
+ParametricExpression::Value ParametricExpression::Value::fromNumber(double d)
+{
+    Value v;
+    v.type = Number;
+    v.number = d;
+    return v;
+}
+
+ParametricExpression::Value ParametricExpression::Value::fromString(const QString &s)
+{
+    Value v;
+    v.type = String;
+    v.string = s;
+    return v;
+}
+
+ParametricExpression::Value ParametricExpression::Value::fromBoolean(bool b)
+{
+    Value v;
+    v.type = Boolean;
+    v.number = b ? 1.0 : 0.0;
+    return v;
+}
+
+/*!
+  * Convert parameter value to expression value
+  *
+  * \param[in] v parameter value
+  * \return expression value. Undefined for an invalid QVariant
+  */
+ParametricExpression::Value ParametricExpression::Value::fromVariant(const QVariant &v)
+{
+    switch (v.type()) {
+    case QVariant::Invalid:
+        return Value();
+    case QVariant::Bool:
+        return fromBoolean(v.toBool());
+    case QVariant::Double:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        return fromNumber(v.toDouble());
+    default:
+        if(static_cast<QMetaType::Type>(v.type()) == QMetaType::Float){
+            return fromNumber(v.toDouble());
+        }
+        return fromString(v.toString());
+    }
+}
+
+/*!
+  * Convert value to number as JavaScript Number() does
+  *
+  * \return number. NaN if the string is not a number
+  */
+double ParametricExpression::Value::toNumber() const
+{
+    switch (type) {
+    case Boolean:
+    case Number:
+        return number;
+    case String: {
+        const QString trimmed = string.trimmed();
+        if(trimmed.isEmpty()){
+            return 0.0;
+        }
+        if(trimmed == QLatin1String("Infinity") || trimmed == QLatin1String("+Infinity")){
+            return std::numeric_limits<double>::infinity();
+        }
+        if(trimmed == QLatin1String("-Infinity")){
+            return -std::numeric_limits<double>::infinity();
+        }
+        //Шестнадцатеричные, восьмеричные и двоичные строки без знака
+        if(trimmed.size() > 2 && trimmed.at(0) == QLatin1Char('0')){
+            const QChar prefix = trimmed.at(1).toLower();
+            const int base = prefix == QLatin1Char('x') ? 16 : (prefix == QLatin1Char('o') ? 8 : (prefix == QLatin1Char('b') ? 2 : 0));
+            if(base){
+                double d = 0.0;
+                for (int i = 2; i < trimmed.size(); ++i) {
+                    const ushort c = trimmed.at(i).toLower().unicode();
+                    const int digit = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : base);
+                    if(digit >= base){
+                        return qQNaN();
+                    }
+                    d = d * base + digit;
+                }
+                return d;
+            }
+        }
+        //QString::toDouble() принимает также "inf" и "nan"
+        for (int i = 0; i < trimmed.size(); ++i) {
+            const QChar c = trimmed.at(i);
+            if(!c.isDigit() && c != QLatin1Char('.') && c != QLatin1Char('+') && c != QLatin1Char('-')
+                    && c.toLower() != QLatin1Char('e')){
+                return qQNaN();
+            }
+        }
+        bool ok = false;
+        double d = trimmed.toDouble(&ok);
+        return ok ? d : qQNaN();
+    }
+    default:
+        return qQNaN();
+    }
+}
+
+/*!
+  * Convert value to string as JavaScript String() does
+  *
+  * \return string
+  */
+QString ParametricExpression::Value::toString() const
+{
+    switch (type) {
+    case Boolean:
+        return number != 0.0 ? QStringLiteral("true") : QStringLiteral("false");
+    case Number:
+        return numberToString(number);
+    case String:
+        return string;
+    default:
+        return QStringLiteral("undefined");
+    }
+}
+
+bool ParametricExpression::Value::toBoolean() const
+{
+    switch (type) {
+    case Boolean:
+    case Number:
+        return number != 0.0 && !qIsNaN(number);
+    case String:
+        return !string.isEmpty();
+    default:
+        return false;
+    }
+}
+
+QVariant ParametricExpression::Value::toVariant() const
+{
+    switch (type) {
+    case Boolean:
+        return QVariant(number != 0.0);
+    case Number:
+        return QVariant(number);
+    case String:
+        return QVariant(string);
+    default:
+        return QVariant();
+    }
+}
+
+ParametricExpression::ParametricExpression():
+    m_root(-1),
+    m_position(0),
+    m_names(nullptr),
+    m_isFailed(false)
+{
+}
+
+/*!
+  * Compile source into expression tree
+  *
+  * \param[in] source JavaScript expression
+  * \param[in] names variable names and their indexes in the environment
+  * \return true, if the source belongs to the supported subset
+  */
+bool ParametricExpression::compile(const QString &source, const QHash<QString, int> &names)
+{
+    m_nodes.clear();
+    m_root = -1;
+    m_position = 0;
+    m_names = &names;
+    m_isFailed = false;
+
+    m_source = source.trimmed();
+    while (m_source.endsWith(QLatin1Char(';'))) {
+        m_source.chop(1);
+    }
+
+    int root = m_source.isEmpty() ? fail() : parseExpression();
+    skipSpaces();
+    if(root >= 0 && !m_isFailed && m_position == m_source.size()){
+        m_root = root;
+    }else{
+        m_nodes.clear();
+    }
+
+    m_source.clear();
+    m_names = nullptr;
+    return isValid();
+}
+
+bool ParametricExpression::isValid() const
+{
+    return m_root >= 0;
+}
+
+/*!
+  * Evaluate compiled expression
+  *
+  * \param[in] environment values of variables by indexes given to compile()
+  * \param[out] result value of the expression
+  * \param[out] error message on error
+  * \return true on succes
+  */
+bool ParametricExpression::evaluate(const QVector<Value> &environment, Value *result, QString *error) const
+{
+    if(m_root < 0){
+        *error = QStringLiteral("Expression is not compiled");
+        return false;
+    }
+    return evaluateNode(m_root, environment, result, error);
+}
+
+/*!
+  * Convert number to string as JavaScript Number.prototype.toString() does
+  *
+  * \param[in] value number
+  * \return the shortest string that reads back as the same number
+  */
+QString ParametricExpression::numberToString(double value)
+{
+    if(qIsNaN(value)){
+        return QStringLiteral("NaN");
+    }
+    if(qIsInf(value)){
+        return value > 0 ? QStringLiteral("Infinity") : QStringLiteral("-Infinity");
+    }
+    if(value == 0.0){
+        return QStringLiteral("0");
+    }
+
+    QString sign;
+    if(value < 0){
+        sign = QStringLiteral("-");
+        value = -value;
+    }
+
+    //d.ddde±XX с минимальным числом цифр
+    const QString scientific = QString::number(value, 'e', QLocale::FloatingPointShortest);
+    const int e = scientific.indexOf(QLatin1Char('e'));
+    QString digits = scientific.left(e);
+    digits.remove(QLatin1Char('.'));
+    while (digits.size() > 1 && digits.endsWith(QLatin1Char('0'))) {
+        digits.chop(1);
+    }
+    const int k = digits.size();
+    const int n = scientific.midRef(e + 1).toInt() + 1;
+
+    if(k <= n && n <= 21){
+        return sign + digits + QString(n - k, QLatin1Char('0'));
+    }
+    if(0 < n && n <= 21){
+        return sign + digits.left(n) + QLatin1Char('.') + digits.mid(n);
+    }
+    if(-6 < n && n <= 0){
+        return sign + QStringLiteral("0.") + QString(-n, QLatin1Char('0')) + digits;
+    }
+
+    QString exponent = QString::number(qAbs(n - 1));
+    QString mantissa = k == 1 ? digits : digits.left(1) + QLatin1Char('.') + digits.mid(1);
+    return sign + mantissa + QLatin1Char('e') + (n - 1 < 0 ? QLatin1Char('-') : QLatin1Char('+')) + exponent;
+}
+
+int ParametricExpression::addNode(ParametricExpression::Operation operation, const QVector<int> &operands)
+{
+    Node node;
+    node.operation = operation;
+    node.index = -1;
+    node.operands = operands;
+    m_nodes.append(node);
+    return m_nodes.size() - 1;
+}
+
+int ParametricExpression::addConstant(const ParametricExpression::Value &value)
+{
+    int index = addNode(Constant);
+    m_nodes[index].value = value;
+    return index;
+}
+
+void ParametricExpression::skipSpaces()
+{
+    while (m_position < m_source.size() && m_source.at(m_position).isSpace()) {
+        ++m_position;
+    }
+}
+
+bool ParametricExpression::peek(const char *token)
+{
+    skipSpaces();
+    const QLatin1String latin(token);
+    return m_source.midRef(m_position, latin.size()) == latin;
+}
+
+bool ParametricExpression::accept(const char *token)
+{
+    if(!peek(token)){
+        return false;
+    }
+    m_position += QLatin1String(token).size();
+    return true;
+}
+
+QString ParametricExpression::readIdentifier()
+{
+    skipSpaces();
+    int start = m_position;
+    while (m_position < m_source.size()) {
+        const QChar c = m_source.at(m_position);
+        bool isIdentifierChar = c.isLetter() || c == QLatin1Char('_') || c == QLatin1Char('$')
+                || (m_position > start && c.isDigit());
+        if(!isIdentifierChar){
+            break;
+        }
+        ++m_position;
+    }
+    return m_source.mid(start, m_position - start);
+}
+
+/*!
+  * Stop parsing: the source is outside the supported subset
+  *
+  * \return invalid node index
+  */
+int ParametricExpression::fail()
+{
+    m_isFailed = true;
+    return -1;
+}
+
+int ParametricExpression::parseExpression()
+{
+    return parseConditional();
+}
+
+int ParametricExpression::parseConditional()
+{
+    int condition = parseOr();
+    if(condition < 0){
+        return -1;
+    }
+    if(peek("??") || peek("?.")){
+        return fail();
+    }
+    if(!accept("?")){
+        return condition;
+    }
+
+    int whenTrue = parseConditional();
+    if(whenTrue < 0 || !accept(":")){
+        return fail();
+    }
+    int whenFalse = parseConditional();
+    if(whenFalse < 0){
+        return -1;
+    }
+    return addNode(Conditional, QVector<int>() << condition << whenTrue << whenFalse);
+}
+
+int ParametricExpression::parseOr()
+{
+    int left = parseAnd();
+    while (left >= 0 && accept("||")) {
+        int right = parseAnd();
+        if(right < 0){
+            return -1;
+        }
+        left = addNode(Or, QVector<int>() << left << right);
+    }
+    return left;
+}
+
+int ParametricExpression::parseAnd()
+{
+    int left = parseEquality();
+    while (left >= 0 && accept("&&")) {
+        int right = parseEquality();
+        if(right < 0){
+            return -1;
+        }
+        left = addNode(And, QVector<int>() << left << right);
+    }
+    return left;
+}
+
+int ParametricExpression::parseEquality()
+{
+    int left = parseRelational();
+    while (left >= 0) {
+        Operation operation;
+        if(accept("===")){
+            operation = StrictEqual;
+        }else if(accept("!==")){
+            operation = StrictNotEqual;
+        }else if(accept("==")){
+            operation = Equal;
+        }else if(accept("!=")){
+            operation = NotEqual;
+        }else{
+            break;
+        }
+        int right = parseRelational();
+        if(right < 0){
+            return -1;
+        }
+        left = addNode(operation, QVector<int>() << left << right);
+    }
+    return left;
+}
+
+int ParametricExpression::parseRelational()
+{
+    int left = parseAdditive();
+    while (left >= 0) {
+        if(peek("<<") || peek(">>")){
+            return fail();
+        }
+        Operation operation;
+        if(accept("<=")){
+            operation = LessOrEqual;
+        }else if(accept(">=")){
+            operation = GreaterOrEqual;
+        }else if(accept("<")){
+            operation = Less;
+        }else if(accept(">")){
+            operation = Greater;
+        }else{
+            break;
+        }
+        int right = parseAdditive();
+        if(right < 0){
+            return -1;
+        }
+        left = addNode(operation, QVector<int>() << left << right);
+    }
+    return left;
+}
+
+int ParametricExpression::parseAdditive()
+{
+    int left = parseMultiplicative();
+    while (left >= 0) {
+        if(peek("++") || peek("--")){
+            return fail();
+        }
+        Operation operation;
+        if(accept("+")){
+            operation = Add;
+        }else if(accept("-")){
+            operation = Subtract;
+        }else{
+            break;
+        }
+        int right = parseMultiplicative();
+        if(right < 0){
+            return -1;
+        }
+        left = addNode(operation, QVector<int>() << left << right);
+    }
+    return left;
+}
+
+int ParametricExpression::parseMultiplicative()
+{
+    int left = parseUnary();
+    while (left >= 0) {
+        if(peek("**")){
+            return fail();
+        }
+        Operation operation;
+        if(accept("*")){
+            operation = Multiply;
+        }else if(accept("/")){
+            operation = Divide;
+        }else if(accept("%")){
+            operation = Modulo;
+        }else{
+            break;
+        }
+        int right = parseUnary();
+        if(right < 0){
+            return -1;
+        }
+        left = addNode(operation, QVector<int>() << left << right);
+    }
+    return left;
+}
+
+int ParametricExpression::parseUnary()
+{
+    if(peek("++") || peek("--")){
+        return fail();
+    }
+
+    Operation operation;
+    if(accept("-")){
+        operation = Negate;
+    }else if(accept("+")){
+        operation = Plus;
+    }else if(accept("!")){
+        operation = Not;
+    }else{
+        return parsePrimary();
+    }
+
+    int operand = parseUnary();
+    if(operand < 0){
+        return -1;
+    }
+    return addNode(operation, QVector<int>() << operand);
+}
+
+int ParametricExpression::parsePrimary()
+{
+    skipSpaces();
+    if(m_position >= m_source.size()){
+        return fail();
+    }
+
+    const QChar c = m_source.at(m_position);
+    const QChar next = m_position + 1 < m_source.size() ? m_source.at(m_position + 1) : QChar();
+    if(c.isDigit() || (c == QLatin1Char('.') && next.isDigit())){
+        return parseNumber();
+    }
+    if(c == QLatin1Char('\'') || c == QLatin1Char('"')){
+        return parseString(c);
+    }
+    if(c == QLatin1Char('`')){
+        return parseTemplate();
+    }
+    if(c == QLatin1Char('(')){
+        ++m_position;
+        int inner = parseExpression();
+        if(inner < 0 || !accept(")")){
+            return fail();
+        }
+        return inner;
+    }
+
+    const QString name = readIdentifier();
+    if(name.isEmpty()){
+        return fail();
+    }
+    if(name == QLatin1String("true") || name == QLatin1String("false")){
+        return addConstant(Value::fromBoolean(name == QLatin1String("true")));
+    }
+    if(name == QLatin1String("Math") && !m_names->contains(name)){
+        return parseMath();
+    }
+
+    QHash<QString, int>::const_iterator i = m_names->constFind(name);
+    //Методы и свойства значений (A.toFixed(2)) не поддерживаются
+    if(i == m_names->constEnd() || peek(".") || peek("(") || peek("[")){
+        return fail();
+    }
+
+    int index = addNode(Variable);
+    m_nodes[index].index = i.value();
+    m_nodes[index].value = Value::fromString(name);
+    return index;
+}
+
+int ParametricExpression::parseNumber()
+{
+    const int size = m_source.size();
+    const int start = m_position;
+
+    if(m_source.at(m_position) == QLatin1Char('0') && m_position + 1 < size
+            && (m_source.at(m_position + 1).isDigit()
+                || (m_source.at(m_position + 1).isLetter()
+                    && m_source.at(m_position + 1).toLower() != QLatin1Char('e')))){
+        //Шестнадцатеричные, восьмеричные (в том числе устаревшие 010) и двоичные литералы
+        return fail();
+    }
+
+    while (m_position < size && m_source.at(m_position).isDigit()) {
+        ++m_position;
+    }
+    if(m_position < size && m_source.at(m_position) == QLatin1Char('.')){
+        ++m_position;
+        while (m_position < size && m_source.at(m_position).isDigit()) {
+            ++m_position;
+        }
+    }
+    if(m_position < size && m_source.at(m_position).toLower() == QLatin1Char('e')){
+        ++m_position;
+        if(m_position < size && (m_source.at(m_position) == QLatin1Char('+')
+                                  || m_source.at(m_position) == QLatin1Char('-'))){
+            ++m_position;
+        }
+        if(m_position >= size || !m_source.at(m_position).isDigit()){
+            return fail();
+        }
+        while (m_position < size && m_source.at(m_position).isDigit()) {
+            ++m_position;
+        }
+    }
+    if(m_position < size && (m_source.at(m_position).isLetterOrNumber()
+                              || m_source.at(m_position) == QLatin1Char('_'))){
+        return fail();
+    }
+
+    bool ok = false;
+    double number = m_source.midRef(start, m_position - start).toDouble(&ok);
+    if(!ok){
+        return fail();
+    }
+    return addConstant(Value::fromNumber(number));
+}
+
+int ParametricExpression::parseString(QChar quote)
+{
+    ++m_position;
+    QString text;
+    while (m_position < m_source.size()) {
+        const QChar c = m_source.at(m_position);
+        if(c == quote){
+            ++m_position;
+            return addConstant(Value::fromString(text));
+        }
+        if(c == QLatin1Char('\\')){
+            ++m_position;
+            if(!readEscape(text)){
+                return fail();
+            }
+            continue;
+        }
+        if(c == QLatin1Char('\n')){
+            return fail();
+        }
+        text.append(c);
+        ++m_position;
+    }
+    return fail();
+}
+
+int ParametricExpression::parseTemplate()
+{
+    ++m_position;
+    QVector<int> parts;
+    QString text;
+    while (m_position < m_source.size()) {
+        const QChar c = m_source.at(m_position);
+        if(c == QLatin1Char('`')){
+            ++m_position;
+            if(!text.isEmpty() || parts.isEmpty()){
+                parts.append(addConstant(Value::fromString(text)));
+            }
+            return addNode(Template, parts);
+        }
+        if(c == QLatin1Char('\\')){
+            ++m_position;
+            if(!readEscape(text)){
+                return fail();
+            }
+            continue;
+        }
+        if(c == QLatin1Char('$') && m_position + 1 < m_source.size()
+                && m_source.at(m_position + 1) == QLatin1Char('{')){
+            m_position += 2;
+            if(!text.isEmpty()){
+                parts.append(addConstant(Value::fromString(text)));
+                text.clear();
+            }
+            int substitution = parseExpression();
+            if(substitution < 0 || !accept("}")){
+                return fail();
+            }
+            parts.append(substitution);
+            continue;
+        }
+        //CR LF в шаблоне читается как LF
+        if(c == QLatin1Char('\r')){
+            ++m_position;
+            if(m_position < m_source.size() && m_source.at(m_position) == QLatin1Char('\n')){
+                continue;
+            }
+            text.append(QLatin1Char('\n'));
+            continue;
+        }
+        text.append(c);
+        ++m_position;
+    }
+    return fail();
+}
+
+int ParametricExpression::parseMath()
+{
+    struct MathName {
+        const char *name;
+        int function;
+    };
+    static const MathName functions[] = {
+        {"abs", Abs}, {"acos", Acos}, {"asin", Asin}, {"atan", Atan}, {"atan2", Atan2},
+        {"ceil", Ceil}, {"cos", Cos}, {"exp", Exp}, {"floor", Floor}, {"log", Log},
+        {"max", Max}, {"min", Min}, {"pow", Pow}, {"round", Round}, {"sign", Sign},
+        {"sin", Sin}, {"sqrt", Sqrt}, {"tan", Tan}, {"trunc", Trunc}
+    };
+
+    if(!accept(".")){
+        return fail();
+    }
+    const QString name = readIdentifier();
+
+    if(name == QLatin1String("PI")){
+        return addConstant(Value::fromNumber(M_PI));
+    }
+    if(name == QLatin1String("E")){
+        return addConstant(Value::fromNumber(M_E));
+    }
+    if(name == QLatin1String("LN2")){
+        return addConstant(Value::fromNumber(M_LN2));
+    }
+    if(name == QLatin1String("LN10")){
+        return addConstant(Value::fromNumber(M_LN10));
+    }
+    if(name == QLatin1String("SQRT2")){
+        return addConstant(Value::fromNumber(M_SQRT2));
+    }
+
+    int function = -1;
+    for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); ++i) {
+        if(name == QLatin1String(functions[i].name)){
+            function = functions[i].function;
+            break;
+        }
+    }
+    if(function < 0 || !accept("(")){
+        return fail();
+    }
+
+    QVector<int> arguments;
+    if(!accept(")")){
+        do {
+            int argument = parseConditional();
+            if(argument < 0){
+                return -1;
+            }
+            arguments.append(argument);
+        } while (accept(","));
+        if(!accept(")")){
+            return fail();
+        }
+    }
+
+    int index = addNode(MathCall, arguments);
+    m_nodes[index].index = function;
+    return index;
+}
+
+/*!
+  * Read escape sequence after backslash in string or template literal
+  *
+  * \param[in,out] text literal text
+  * \return false on unsupported sequence
+  */
+bool ParametricExpression::readEscape(QString &text)
+{
+    if(m_position >= m_source.size()){
+        return false;
+    }
+    const QChar c = m_source.at(m_position);
+    ++m_position;
+
+    switch (c.unicode()) {
+    case 'n': text.append(QLatin1Char('\n')); return true;
+    case 't': text.append(QLatin1Char('\t')); return true;
+    case 'r': text.append(QLatin1Char('\r')); return true;
+    case 'b': text.append(QLatin1Char('\b')); return true;
+    case 'f': text.append(QLatin1Char('\f')); return true;
+    case 'v': text.append(QLatin1Char('\v')); return true;
+    case '\n': return true;
+    case 'u':
+    case 'x': {
+        const int length = c == QLatin1Char('u') ? 4 : 2;
+        bool ok = false;
+        ushort code = m_source.midRef(m_position, length).toUShort(&ok, 16);
+        if(!ok || m_position + length > m_source.size()){
+            return false;
+        }
+        m_position += length;
+        text.append(QChar(code));
+        return true;
+    }
+    default:
+        if(c.isDigit()){
+            //Восьмеричные последовательности
+            return false;
+        }
+        text.append(c);
+        return true;
+    }
+}
+
+bool ParametricExpression::evaluateNode(int index, const QVector<Value> &environment, Value *result, QString *error) const
+{
+    const Node &node = m_nodes.at(index);
+    switch (node.operation) {
+    case Constant:
+        *result = node.value;
+        return true;
+
+    case Variable:
+        if(node.index >= environment.size() || environment.at(node.index).isUndefined()){
+            *error = QStringLiteral("%1 is not defined").arg(node.value.string);
+            return false;
+        }
+        *result = environment.at(node.index);
+        return true;
+
+    case Template: {
+        QString text;
+        Value part;
+        for (int i = 0; i < node.operands.size(); ++i) {
+            if(!evaluateNode(node.operands.at(i), environment, &part, error)){
+                return false;
+            }
+            text.append(part.toString());
+        }
+        *result = Value::fromString(text);
+        return true;
+    }
+
+    case Negate:
+    case Plus:
+    case Not: {
+        Value operand;
+        if(!evaluateNode(node.operands.at(0), environment, &operand, error)){
+            return false;
+        }
+        if(node.operation == Not){
+            *result = Value::fromBoolean(!operand.toBoolean());
+        }else{
+            double number = operand.toNumber();
+            *result = Value::fromNumber(node.operation == Negate ? -number : number);
+        }
+        return true;
+    }
+
+    case And:
+    case Or: {
+        if(!evaluateNode(node.operands.at(0), environment, result, error)){
+            return false;
+        }
+        //Второй операнд вычисляется только при необходимости
+        if(result->toBoolean() == (node.operation == Or)){
+            return true;
+        }
+        return evaluateNode(node.operands.at(1), environment, result, error);
+    }
+
+    case Conditional: {
+        Value condition;
+        if(!evaluateNode(node.operands.at(0), environment, &condition, error)){
+            return false;
+        }
+        return evaluateNode(node.operands.at(condition.toBoolean() ? 1 : 2), environment, result, error);
+    }
+
+    case MathCall: {
+        QVarLengthArray<double, 4> arguments;
+        Value argument;
+        for (int i = 0; i < node.operands.size(); ++i) {
+            if(!evaluateNode(node.operands.at(i), environment, &argument, error)){
+                return false;
+            }
+            arguments.append(argument.toNumber());
+        }
+        *result = Value::fromNumber(callMath(node.index, arguments.constData(), arguments.size()));
+        return true;
+    }
+
+    default:
+        break;
+    }
+
+    Value left;
+    Value right;
+    if(!evaluateNode(node.operands.at(0), environment, &left, error)
+            || !evaluateNode(node.operands.at(1), environment, &right, error)){
+        return false;
+    }
+
+    switch (node.operation) {
+    case Add:
+        if(left.type == Value::String || right.type == Value::String){
+            *result = Value::fromString(left.toString() + right.toString());
+        }else{
+            *result = Value::fromNumber(left.toNumber() + right.toNumber());
+        }
+        return true;
+    case Subtract:
+        *result = Value::fromNumber(left.toNumber() - right.toNumber());
+        return true;
+    case Multiply:
+        *result = Value::fromNumber(left.toNumber() * right.toNumber());
+        return true;
+    case Divide:
+        *result = Value::fromNumber(left.toNumber() / right.toNumber());
+        return true;
+    case Modulo:
+        *result = Value::fromNumber(std::fmod(left.toNumber(), right.toNumber()));
+        return true;
+    case Less:
+    case Greater:
+    case LessOrEqual:
+    case GreaterOrEqual: {
+        bool isTrue;
+        if(left.type == Value::String && right.type == Value::String){
+            int compare = QString::compare(left.string, right.string);
+            isTrue = (node.operation == Less && compare < 0)
+                    || (node.operation == Greater && compare > 0)
+                    || (node.operation == LessOrEqual && compare <= 0)
+                    || (node.operation == GreaterOrEqual && compare >= 0);
+        }else{
+            double l = left.toNumber();
+            double r = right.toNumber();
+            isTrue = (node.operation == Less && l < r)
+                    || (node.operation == Greater && l > r)
+                    || (node.operation == LessOrEqual && l <= r)
+                    || (node.operation == GreaterOrEqual && l >= r);
+        }
+        *result = Value::fromBoolean(isTrue);
+        return true;
+    }
+    case Equal:
+        *result = Value::fromBoolean(looseEquals(left, right));
+        return true;
+    case NotEqual:
+        *result = Value::fromBoolean(!looseEquals(left, right));
+        return true;
+    case StrictEqual:
+        *result = Value::fromBoolean(strictEquals(left, right));
+        return true;
+    case StrictNotEqual:
+        *result = Value::fromBoolean(!strictEquals(left, right));
+        return true;
+    default:
+        *error = QStringLiteral("Unknown operation");
+        return false;
+    }
+}
+
+bool ParametricExpression::looseEquals(const ParametricExpression::Value &left, const ParametricExpression::Value &right)
+{
+    if(left.type == right.type){
+        return strictEquals(left, right);
+    }
+    if(left.type == Value::Undefined || right.type == Value::Undefined){
+        return false;
+    }
+    return left.toNumber() == right.toNumber();
+}
+
+bool ParametricExpression::strictEquals(const ParametricExpression::Value &left, const ParametricExpression::Value &right)
+{
+    if(left.type != right.type){
+        return false;
+    }
+    switch (left.type) {
+    case Value::String:
+        return left.string == right.string;
+    case Value::Undefined:
+        return true;
+    default:
+        return left.number == right.number;
+    }
+}
+
+double ParametricExpression::callMath(int function, const double *arguments, int count)
+{
+    const double nan = qQNaN();
+    const double x = count > 0 ? arguments[0] : nan;
+    const double y = count > 1 ? arguments[1] : nan;
+
+    switch (function) {
+    case Abs: return std::fabs(x);
+    case Acos: return std::acos(x);
+    case Asin: return std::asin(x);
+    case Atan: return std::atan(x);
+    case Atan2: return std::atan2(x, y);
+    case Ceil: return std::ceil(x);
+    case Cos: return std::cos(x);
+    case Exp: return std::exp(x);
+    case Floor: return std::floor(x);
+    case Log: return std::log(x);
+    case Pow: return std::pow(x, y);
+    case Round: {
+        //x + 0.5 округляется при сложении, а Math.round(-0.2) равно -0
+        const double f = std::floor(x);
+        return std::copysign(x - f >= 0.5 ? f + 1.0 : f, x);
+    }
+    case Sign: return qIsNaN(x) ? nan : (x > 0 ? 1.0 : (x < 0 ? -1.0 : x));
+    case Sin: return std::sin(x);
+    case Sqrt: return std::sqrt(x);
+    case Tan: return std::tan(x);
+    case Trunc: return std::trunc(x);
+    case Max:
+    case Min: {
+        double extremum = function == Max ? -std::numeric_limits<double>::infinity()
+                                          : std::numeric_limits<double>::infinity();
+        for (int i = 0; i < count; ++i) {
+            if(qIsNaN(arguments[i])){
+                return nan;
+            }
+            extremum = function == Max ? qMax(extremum, arguments[i]) : qMin(extremum, arguments[i]);
+        }
+        return extremum;
+    }
+    default:
+        return nan;
+    }
+}
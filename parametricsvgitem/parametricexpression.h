@@ -0,0 +1,128 @@
+#ifndef PARAMETRICEXPRESSION_H
+#define PARAMETRICEXPRESSION_H
+
+
+#include <QHash>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+class ParametricExpression
+{
+public:
+    //Значение выражения с семантикой JavaScript
+    struct Value
+    {
+        enum Type {
+            Undefined,
+            Boolean,
+            Number,
+            String
+        };
+
+        Type type;
+        double number;
+        QString string;
+
+        Value();
+        static Value fromNumber(double d);
+        static Value fromString(const QString &s);
+        static Value fromBoolean(bool b);
+        static Value fromVariant(const QVariant &v);
+
+        bool isUndefined() const {return type == Undefined;}
+        double toNumber() const;
+        QString toString() const;
+        bool toBoolean() const;
+        QVariant toVariant() const;
+    };
+
+    ParametricExpression();
+
+    bool compile(const QString &source, const QHash<QString, int> &names);
+    bool isValid() const;
+    bool evaluate(const QVector<Value> &environment, Value *result, QString *error) const;
+
+    static QString numberToString(double value);
+
+private:
+    enum Operation {
+        Constant,
+        Variable,
+        Template,
+        Negate,
+        Plus,
+        Not,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Modulo,
+        Less,
+        Greater,
+        LessOrEqual,
+        GreaterOrEqual,
+        Equal,
+        NotEqual,
+        StrictEqual,
+        StrictNotEqual,
+        And,
+        Or,
+        Conditional,
+        MathCall
+    };
+
+    enum MathFunction {
+        Abs, Acos, Asin, Atan, Atan2, Ceil, Cos, Exp, Floor, Log,
+        Max, Min, Pow, Round, Sign, Sin, Sqrt, Tan, Trunc
+    };
+
+    //Узел дерева выражения; дочерние узлы хранятся по индексам в m_nodes
+    struct Node {
+        Operation operation;
+        Value value;
+        int index;
+        QVector<int> operands;
+    };
+
+    QVector<Node> m_nodes;
+    int m_root;
+
+    //Состояние разбора
+    QString m_source;
+    int m_position;
+    const QHash<QString, int> *m_names;
+    bool m_isFailed;
+
+    int addNode(Operation operation, const QVector<int> &operands = QVector<int>());
+    int addConstant(const Value &value);
+
+    void skipSpaces();
+    bool peek(const char *token);
+    bool accept(const char *token);
+    QString readIdentifier();
+    int fail();
+
+    int parseExpression();
+    int parseConditional();
+    int parseOr();
+    int parseAnd();
+    int parseEquality();
+    int parseRelational();
+    int parseAdditive();
+    int parseMultiplicative();
+    int parseUnary();
+    int parsePrimary();
+    int parseNumber();
+    int parseString(QChar quote);
+    int parseTemplate();
+    int parseMath();
+    bool readEscape(QString &text);
+
+    bool evaluateNode(int index, const QVector<Value> &environment, Value *result, QString *error) const;
+    static bool looseEquals(const Value &left, const Value &right);
+    static bool strictEquals(const Value &left, const Value &right);
+    static double callMath(int function, const double *arguments, int count);
+};
+
+#endif // PARAMETRICEXPRESSION_H
@@ -0,0 +1,105 @@
+/*!
+ * \class ParametricSvgAnimationClock
+ * Single timer advancing parameter transitions of all items once per frame
+ */
+#include "parametricsvganimationclock.h"
+#include "parametricsvgitem.h"
+#include <QCoreApplication>
+
+ParametricSvgAnimationClock::ParametricSvgAnimationClock(QObject *parent):
+    QObject(parent)
+{
+    //Около 60 кадров в секунду
+    m_timer.setInterval(16);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &ParametricSvgAnimationClock::tick);
+    m_time.start();
+}
+
+/*!
+  * Get the clock shared by all items. It must be used from the GUI thread.
+  *
+  * \return clock instance
+  */
+ParametricSvgAnimationClock *ParametricSvgAnimationClock::instance()
+{
+    static ParametricSvgAnimationClock *clock = new ParametricSvgAnimationClock(QCoreApplication::instance());
+    return clock;
+}
+
+/*!
+  * Advance transitions of the item on each tick until it has none
+  *
+  * \param[in] item item with transitions
+  */
+void ParametricSvgAnimationClock::start(ParametricSvgItem *item)
+{
+    if(!m_items.contains(item)){
+        m_items.append(item);
+    }
+    if(!m_timer.isActive()){
+        m_timer.start();
+    }
+}
+
+/*!
+  * Stop advancing transitions of the item
+  *
+  * \param[in] item item with transitions
+  */
+void ParametricSvgAnimationClock::stop(ParametricSvgItem *item)
+{
+    m_items.removeAll(item);
+    if(m_items.isEmpty()){
+        m_timer.stop();
+    }
+}
+
+bool ParametricSvgAnimationClock::isActive() const
+{
+    return m_timer.isActive();
+}
+
+/*!
+  * Get time of the clock
+  *
+  * \return milliseconds since the clock was created
+  */
+qint64 ParametricSvgAnimationClock::elapsed() const
+{
+    return m_time.elapsed();
+}
+
+/*!
+  * Set period of frames
+  *
+  * \param[in] msecs period in milliseconds
+  */
+void ParametricSvgAnimationClock::setInterval(int msecs)
+{
+    m_timer.setInterval(qMax(msecs, 1));
+}
+
+int ParametricSvgAnimationClock::interval() const
+{
+    return m_timer.interval();
+}
+
+/*!
+  * Advance all transitions to the same time
+  */
+void ParametricSvgAnimationClock::tick()
+{
+    const qint64 now = m_time.elapsed();
+
+    //Элемент может завершить переходы и удалиться из списка во время обхода
+    const QList<ParametricSvgItem *> items = m_items;
+    foreach (ParametricSvgItem *item, items) {
+        if(m_items.contains(item) && !item->advanceTransitions(now)){
+            m_items.removeAll(item);
+        }
+    }
+    if(m_items.isEmpty()){
+        m_timer.stop();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PARAMETRICSVGANIMATIONCLOCK_H
+#define PARAMETRICSVGANIMATIONCLOCK_H
+
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class ParametricSvgItem;
+
+class ParametricSvgAnimationClock : public QObject
+{
+    Q_OBJECT
+private:
+    QTimer m_timer;
+    QElapsedTimer m_time;
+    //Элементы с активными переходами
+    QList<ParametricSvgItem *> m_items;
+
+    explicit ParametricSvgAnimationClock(QObject *parent = nullptr);
+
+private slots:
+    void tick();
+
+public:
+    static ParametricSvgAnimationClock *instance();
+
+    void start(ParametricSvgItem *item);
+    void stop(ParametricSvgItem *item);
+    bool isActive() const;
+    qint64 elapsed() const;
+
+    void setInterval(int msecs);
+    int interval() const;
+};
+
+#endif // PARAMETRICSVGANIMATIONCLOCK_H
@@ -0,0 +1,138 @@
+/*!
+ * \class ParametricSvgDataBinding
+ * Map of columns of data snapshots to number parameters of many items.
+ * A snapshot is applied in one pass; only items with changed values are updated.
+ */
+#include "parametricsvgdatabinding.h"
+#include "parametricsvgitem.h"
+#include <QtMath>
+
+ParametricSvgDataBinding::ParametricSvgDataBinding():
+    m_columnCount(0)
+{
+}
+
+/*!
+  * Bind column of snapshots to parameter of the item.
+  * Bindings of the item must be created again after its setContent().
+  *
+  * \param[in] item parametric item
+  * \param[in] pName parameter name
+  * \param[in] column index of the value in snapshots
+  * \return false, if there is no such parameter
+  */
+bool ParametricSvgDataBinding::bind(ParametricSvgItem *item, const QString &pName, int column)
+{
+    if(!item || column < 0){
+        return false;
+    }
+    int handle = item->parameterHandle(pName);
+    if(handle < 0){
+        return false;
+    }
+
+    Link link;
+    link.handle = handle;
+    link.column = column;
+    m_columnCount = qMax(m_columnCount, column + 1);
+
+    for (int i = 0; i < m_targets.size(); ++i) {
+        if(m_targets.at(i).item == item){
+            m_targets[i].links.append(link);
+            return true;
+        }
+    }
+    Target target;
+    target.item = item;
+    target.links.append(link);
+    m_targets.append(target);
+    return true;
+}
+
+/*!
+  * Remove all bindings of the item
+  *
+  * \param[in] item parametric item
+  */
+void ParametricSvgDataBinding::unbind(ParametricSvgItem *item)
+{
+    for (int i = 0; i < m_targets.size(); ++i) {
+        if(m_targets.at(i).item == item){
+            m_targets.remove(i);
+            return;
+        }
+    }
+}
+
+void ParametricSvgDataBinding::clear()
+{
+    m_targets.clear();
+    m_columnCount = 0;
+}
+
+/*!
+  * Get size of snapshots required by the bindings
+  *
+  * \return number of columns
+  */
+int ParametricSvgDataBinding::columnCount() const
+{
+    return m_columnCount;
+}
+
+int ParametricSvgDataBinding::linksCount() const
+{
+    int count = 0;
+    foreach (const Target &target, m_targets) {
+        count += target.links.size();
+    }
+    return count;
+}
+
+/*!
+  * Set values of the snapshot to the bound parameters. Equal values are
+  * skipped, and each item with changed values is evaluated once
+  * according to its update mode. NaN means no value in the column.
+  *
+  * \param[in] values snapshot
+  * \param[in] count number of values in the snapshot
+  * \return number of updated items
+  */
+int ParametricSvgDataBinding::apply(const double *values, int count)
+{
+    int updated = 0;
+    for (int i = 0; i < m_targets.size(); ++i) {
+        ParametricSvgItem *item = m_targets.at(i).item.data();
+        if(!item){
+            continue;
+        }
+
+        bool isChanged = false;
+        foreach (const Link &link, m_targets.at(i).links) {
+            if(link.column >= count){
+                continue;
+            }
+            const double value = values[link.column];
+            if(qIsNaN(value) || item->parameterNumber(link.handle) == value){
+                continue;
+            }
+            //Пересчёт элемента откладывается до последнего параметра
+            if(!isChanged){
+                item->beginUpdate();
+                isChanged = true;
+            }
+            item->updateByParameter(link.handle, value);
+        }
+
+        if(isChanged){
+            item->endUpdate();
+            ++updated;
+        }
+    }
+    return updated;
+}
+
+int ParametricSvgDataBinding::apply(const QVector<double> &values)
+{
+    return apply(values.constData(), values.size());
+}
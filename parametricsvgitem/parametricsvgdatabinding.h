@@ -0,0 +1,42 @@
+#ifndef PARAMETRICSVGDATABINDING_H
+#define PARAMETRICSVGDATABINDING_H
+
+
+#include <QPointer>
+#include <QString>
+#include <QVector>
+
+class ParametricSvgItem;
+
+class ParametricSvgDataBinding
+{
+private:
+    //Параметр элемента и столбец снимка данных
+    struct Link {
+        int handle;
+        int column;
+    };
+
+    //Связи сгруппированы по элементам, чтобы обновлять элемент один раз
+    struct Target {
+        QPointer<ParametricSvgItem> item;
+        QVector<Link> links;
+    };
+
+    QVector<Target> m_targets;
+    int m_columnCount;
+
+public:
+    ParametricSvgDataBinding();
+
+    bool bind(ParametricSvgItem *item, const QString &pName, int column);
+    void unbind(ParametricSvgItem *item);
+    void clear();
+    int columnCount() const;
+    int linksCount() const;
+
+    int apply(const double *values, int count);
+    int apply(const QVector<double> &values);
+};
+
+#endif // PARAMETRICSVGDATABINDING_H
@@ -0,0 +1,203 @@
+/*!
+ * \class ParametricSvgDiagnostics
+ * Bounded log of evaluation errors. Repeated errors are counted in one entry,
+ * and the least recently seen entries are replaced when the log is full.
+ */
+#include "parametricsvgdiagnostics.h"
+#include <algorithm>
+
+ParametricSvgDiagnostics::ParametricSvgDiagnostics(int capacity):
+    m_sequence(0),
+    m_capacity(qMax(capacity, 1)),
+    m_generation(0)
+{
+}
+
+/*!
+  * Set maximal number of distinct errors. The log is cleared.
+  *
+  * \param[in] capacity number of entries
+  */
+void ParametricSvgDiagnostics::setCapacity(int capacity)
+{
+    m_capacity = qMax(capacity, 1);
+    clear();
+}
+
+int ParametricSvgDiagnostics::capacity() const
+{
+    return m_capacity;
+}
+
+/*!
+  * Start a new update. Errors of previous updates stay in the log,
+  * but are not current.
+  */
+void ParametricSvgDiagnostics::beginGeneration()
+{
+    ++m_generation;
+}
+
+quint64 ParametricSvgDiagnostics::generation() const
+{
+    return m_generation;
+}
+
+/*!
+  * Add error to the current update
+  *
+  * \param[in] site kind of the source
+  * \param[in] index index of parameter, expression or attribute
+  * \param[in] source evaluated source
+  * \param[in] message error message
+  * \return true, if the error is not in the log
+  */
+bool ParametricSvgDiagnostics::report(ParametricSvgDiagnostic::Site site, int index,
+                                      const QString &source, const QString &message)
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    const QString entryKey = key(site, index, message);
+
+    QHash<QString, int>::const_iterator i = m_slots.constFind(entryKey);
+    if(i != m_slots.constEnd()){
+        ParametricSvgDiagnostic &entry = m_entries[i.value()];
+        m_used[i.value()] = ++m_sequence;
+        entry.lastTime = now;
+        entry.generation = m_generation;
+        ++entry.count;
+        return false;
+    }
+
+    ParametricSvgDiagnostic entry;
+    entry.site = site;
+    entry.index = index;
+    entry.source = source;
+    entry.message = message;
+    entry.firstTime = now;
+    entry.lastTime = now;
+    entry.count = 1;
+    entry.generation = m_generation;
+
+    //Заменяется запись, которая дольше всех не повторялась,
+    //чтобы постоянная ошибка не вытеснялась и не сообщалась снова как новая
+    ++m_sequence;
+    if(m_entries.size() < m_capacity){
+        m_entries.append(entry);
+        m_inserted.append(m_sequence);
+        m_used.append(m_sequence);
+        m_slots.insert(entryKey, m_entries.size() - 1);
+    }else{
+        int oldest = 0;
+        for (int j = 1; j < m_used.size(); ++j) {
+            if(m_used.at(j) < m_used.at(oldest)){
+                oldest = j;
+            }
+        }
+        const ParametricSvgDiagnostic &replaced = m_entries.at(oldest);
+        m_slots.remove(key(replaced.site, replaced.index, replaced.message));
+        m_entries[oldest] = entry;
+        m_inserted[oldest] = m_sequence;
+        m_used[oldest] = m_sequence;
+        m_slots.insert(entryKey, oldest);
+    }
+
+    if(m_new.size() >= m_capacity){
+        m_new.removeFirst();
+    }
+    m_new.append(entry);
+    return true;
+}
+
+/*!
+  * Add errors of another log, e.g. of a document in a worker thread, as a new update
+  *
+  * \param[in] diagnostics errors of one update
+  */
+void ParametricSvgDiagnostics::merge(const QVector<ParametricSvgDiagnostic> &diagnostics)
+{
+    beginGeneration();
+    foreach (const ParametricSvgDiagnostic &diagnostic, diagnostics) {
+        report(diagnostic.site, diagnostic.index, diagnostic.source, diagnostic.message);
+    }
+}
+
+/*!
+  * Check whether there were errors in the current update
+  *
+  * \return true, if there are errors
+  */
+bool ParametricSvgDiagnostics::hasCurrent() const
+{
+    foreach (const ParametricSvgDiagnostic &entry, m_entries) {
+        if(entry.generation == m_generation){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+  * Get errors of the current update
+  *
+  * \return errors from the oldest
+  */
+QVector<ParametricSvgDiagnostic> ParametricSvgDiagnostics::current() const
+{
+    QVector<ParametricSvgDiagnostic> result;
+    foreach (const ParametricSvgDiagnostic &entry, entries()) {
+        if(entry.generation == m_generation){
+            result.append(entry);
+        }
+    }
+    return result;
+}
+
+/*!
+  * Get all errors in the log
+  *
+  * \return errors from the oldest
+  */
+QVector<ParametricSvgDiagnostic> ParametricSvgDiagnostics::entries() const
+{
+    //Записи заменяются не по порядку, поэтому упорядочиваются по времени добавления
+    QVector<int> order(m_entries.size());
+    for (int i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return m_inserted.at(a) < m_inserted.at(b);
+    });
+
+    QVector<ParametricSvgDiagnostic> result;
+    result.reserve(order.size());
+    foreach (int i, order) {
+        result.append(m_entries.at(i));
+    }
+    return result;
+}
+
+/*!
+  * Get errors, which were not in the log, since the last call
+  *
+  * \return new errors
+  */
+QVector<ParametricSvgDiagnostic> ParametricSvgDiagnostics::takeNew()
+{
+    QVector<ParametricSvgDiagnostic> result;
+    result.swap(m_new);
+    return result;
+}
+
+void ParametricSvgDiagnostics::clear()
+{
+    m_entries.clear();
+    m_slots.clear();
+    m_inserted.clear();
+    m_used.clear();
+    m_new.clear();
+}
+
+QString ParametricSvgDiagnostics::key(ParametricSvgDiagnostic::Site site, int index, const QString &message)
+{
+    return QString::number(site) + QLatin1Char(':') + QString::number(index) + QLatin1Char(':') + message;
+}
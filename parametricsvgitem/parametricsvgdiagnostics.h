@@ -0,0 +1,72 @@
+#ifndef PARAMETRICSVGDIAGNOSTICS_H
+#define PARAMETRICSVGDIAGNOSTICS_H
+
+
+#include <QDateTime>
+#include <QHash>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+//Ошибка вычисления и её повторения
+struct ParametricSvgDiagnostic
+{
+    enum Site {
+        UpdateSite,
+        ParameterSite,
+        ExpressionSite,
+        AttributeSite
+    };
+
+    Site site = UpdateSite;
+    //Номер параметра, выражения или атрибута в шаблоне
+    int index = -1;
+    QString source;
+    QString message;
+    QDateTime firstTime;
+    QDateTime lastTime;
+    int count = 0;
+    //Номер обновления, в котором ошибка была последний раз
+    quint64 generation = 0;
+};
+
+Q_DECLARE_METATYPE(ParametricSvgDiagnostic)
+
+class ParametricSvgDiagnostics
+{
+private:
+    //Повторения одной ошибки занимают одну запись
+    QVector<ParametricSvgDiagnostic> m_entries;
+    QHash<QString, int> m_slots;
+    //Порядковые номера добавления и последнего повторения каждой записи
+    QVector<quint64> m_inserted;
+    QVector<quint64> m_used;
+    quint64 m_sequence;
+    int m_capacity;
+    quint64 m_generation;
+    //Новые ошибки, ещё не переданные получателю
+    QVector<ParametricSvgDiagnostic> m_new;
+
+    static QString key(ParametricSvgDiagnostic::Site site, int index, const QString &message);
+
+public:
+    explicit ParametricSvgDiagnostics(int capacity = 64);
+
+    void setCapacity(int capacity);
+    int capacity() const;
+
+    void beginGeneration();
+    quint64 generation() const;
+
+    bool report(ParametricSvgDiagnostic::Site site, int index, const QString &source, const QString &message);
+    void merge(const QVector<ParametricSvgDiagnostic> &diagnostics);
+
+    bool hasCurrent() const;
+    QVector<ParametricSvgDiagnostic> current() const;
+    QVector<ParametricSvgDiagnostic> entries() const;
+    QVector<ParametricSvgDiagnostic> takeNew();
+
+    void clear();
+};
+
+#endif // PARAMETRICSVGDIAGNOSTICS_H
@@ -0,0 +1,1489 @@
+/*!
+ * \class ParametricSvgDocument
+ * Evaluation context of parametric SVG without graphics: parameters,
+ * expressions and the evaluated SVG document. A document may be used
+ * from any thread, but only from one thread at a time.
+ */
+#include "parametricsvgdocument.h"
+#include "parametricsvgwatchdog.h"
+#include <QDataStream>
+#include <QJSEngine>
+#include <QThread>
+
+//Снимок параметров: сигнатура "PSVP" и версия формата
+static const quint32 SnapshotMagic = 0x50535650;
+static const quint16 SnapshotVersion = 1;
+
+//Преобразование значений между QJSEngine и встроенным вычислителем
+static QJSValue toScriptValue(const ParametricExpression::Value &value)
+{
+    switch (value.type) {
+    case ParametricExpression::Value::Boolean:
+        return QJSValue(value.toBoolean());
+    case ParametricExpression::Value::Number:
+        return QJSValue(value.number);
+    case ParametricExpression::Value::String:
+        return QJSValue(value.string);
+    default:
+        return QJSValue();
+    }
+}
+
+static ParametricExpression::Value fromScriptValue(const QJSValue &value)
+{
+    if(value.isBool()){
+        return ParametricExpression::Value::fromBoolean(value.toBool());
+    }
+    if(value.isNumber()){
+        return ParametricExpression::Value::fromNumber(value.toNumber());
+    }
+    if(value.isUndefined() || value.isNull()){
+        return ParametricExpression::Value();
+    }
+    return ParametricExpression::Value::fromString(value.toString());
+}
+
+ParametricSvgDocument::ParametricSvgDocument(const QString &namespaceName):
+    m_parameterCount(0),
+    m_jsEngine(nullptr),
+    m_namespace(namespaceName),
+    m_stats(nullptr),
+    m_evaluationBudget(0),
+    m_updateBudget(0),
+    m_isOverrun(false),
+    m_isUpdateExpired(false),
+    m_isFullEvaluationRequired(false),
+    m_isInstancingEnabled(false),
+    m_instancing(nullptr),
+    m_isOverlayChanged(false)
+{
+}
+
+ParametricSvgDocument::~ParametricSvgDocument()
+{
+    resetJsEngine();
+    delete m_stats;
+}
+
+/*!
+  * Enable collection of phase timings and counters.
+  * Disabled statistics cost one pointer check per phase.
+  *
+  * \param[in] isEnabled true to collect
+  */
+void ParametricSvgDocument::setStatsEnabled(bool isEnabled)
+{
+    if(isEnabled == (m_stats != nullptr)){
+        return;
+    }
+    delete m_stats;
+    m_stats = isEnabled ? new ParametricSvgStats() : nullptr;
+}
+
+bool ParametricSvgDocument::isStatsEnabled() const
+{
+    return m_stats != nullptr;
+}
+
+/*!
+  * Get statistics collected after the last resetStats()
+  *
+  * \return statistics. A null pointer, if disabled
+  */
+ParametricSvgStats *ParametricSvgDocument::stats()
+{
+    return m_stats;
+}
+
+void ParametricSvgDocument::resetStats()
+{
+    if(m_stats){
+        m_stats->clear();
+    }
+}
+
+/*!
+  * Set time limit of one JavaScript evaluation. Evaluation is interrupted
+  * by ParametricSvgWatchdog, the error is added to errors(), and the value
+  * of the expression stays unchanged.
+  *
+  * \param[in] msecs limit in milliseconds; 0 for no limit
+  */
+void ParametricSvgDocument::setEvaluationBudget(int msecs)
+{
+    m_evaluationBudget = qMax(msecs, 0);
+}
+
+int ParametricSvgDocument::evaluationBudget() const
+{
+    return m_evaluationBudget;
+}
+
+/*!
+  * Set time limit of evaluateAll() and evaluateChanged(). The rest of
+  * expressions and attributes is not evaluated after the limit, and the
+  * next update evaluates the whole document.
+  *
+  * \param[in] msecs limit in milliseconds; 0 for no limit
+  */
+void ParametricSvgDocument::setUpdateBudget(int msecs)
+{
+    m_updateBudget = qMax(msecs, 0);
+}
+
+int ParametricSvgDocument::updateBudget() const
+{
+    return m_updateBudget;
+}
+
+/*!
+  * Check whether the last update exceeded a time limit.
+  * SVG of such update may be inconsistent and should not be shown.
+  *
+  * \return true, if an evaluation was interrupted or skipped
+  */
+bool ParametricSvgDocument::isOverrun() const
+{
+    return m_isOverrun;
+}
+
+/*!
+  * Check the limit of the update and report it once
+  *
+  * \return true, if the rest of evaluations must be skipped
+  */
+bool ParametricSvgDocument::isUpdateExpired()
+{
+    if(m_isUpdateExpired){
+        return true;
+    }
+    if(m_updateDeadline.isForever() || !m_updateDeadline.hasExpired()){
+        return false;
+    }
+    m_isUpdateExpired = true;
+    m_isOverrun = true;
+    addError(ParametricSvgDiagnostic::UpdateSite, -1, QString(),
+             QString("Update exceeded the time budget of %1 ms").arg(m_updateBudget));
+    return true;
+}
+
+/*!
+  * Load content from SVG file and evaluate parameters
+  *
+  * \param[in] fname Full path to SVG file
+  * \return true on succes
+  */
+bool ParametricSvgDocument::setContent(const QString &fname)
+{
+    //Шаблон разбирается один раз на все документы с тем же файлом
+    QSharedPointer<const ParametricSvgTemplate> svgTemplate = ParametricSvgTemplate::load(fname, m_namespace);
+    if(svgTemplate.isNull()){
+        return false;
+    }
+
+    setTemplate(svgTemplate);
+    evaluateAll();
+    return true;
+}
+
+/*!
+  * Load the template again after its file was changed. Values set by
+  * the document are kept, if the new template has a parameter with
+  * the same name and the value has the same kind (number or not) and
+  * is within the new limits. Other parameters get the new default values.
+  *
+  * \return false, if the file is not changed or can not be loaded
+  */
+bool ParametricSvgDocument::reload()
+{
+    if(m_template.isNull()){
+        return false;
+    }
+    QSharedPointer<const ParametricSvgTemplate> svgTemplate = ParametricSvgTemplate::load(m_template->fileName(), m_namespace);
+    if(svgTemplate.isNull() || svgTemplate == m_template){
+        return false;
+    }
+
+    //Значения по умолчанию старого шаблона не переносятся: действуют новые
+    QVariantMap values;
+    int handle = 0;
+    QMap<QString, Parameter>::const_iterator i = m_template->parameters().constBegin();
+    for (; i != m_template->parameters().constEnd(); ++i, ++handle) {
+        const QVariant value = parameterValue(handle);
+        if(value != i.value().value){
+            values.insert(i.key(), value);
+        }
+    }
+
+    setTemplate(svgTemplate);
+    const QMap<QString, Parameter> &parameters = m_template->parameters();
+    for (QVariantMap::const_iterator j = values.constBegin(); j != values.constEnd(); ++j) {
+        QMap<QString, Parameter>::const_iterator parameter = parameters.constFind(j.key());
+        if(parameter == parameters.constEnd()
+                || isNumberType(parameter.value().value) != isNumberType(j.value())){
+            continue;
+        }
+        //Значение вне новых пределов не устанавливается
+        setParameter(parameterHandle(j.key()), j.value());
+    }
+    evaluateAll();
+    return true;
+}
+
+/*!
+  * Use the template and reset parameters, values and evaluation state
+  *
+  * \param[in] svgTemplate loaded template
+  */
+void ParametricSvgDocument::setTemplate(const QSharedPointer<const ParametricSvgTemplate> &svgTemplate)
+{
+    m_template = svgTemplate;
+    m_diagnostics.clear();
+    const QMap<QString, Parameter> &parameters = m_template->parameters();
+    m_parameterCount = parameters.size();
+    m_parameterNumbers = QVector<double>(m_parameterCount, 0.0);
+    m_parameterVariants = QVector<QVariant>(m_parameterCount);
+    m_isNumberParameter = QVector<bool>(m_parameterCount, false);
+    m_parameterMins.clear();
+    m_parameterMaxs.clear();
+    foreach (const Parameter &param, parameters) {
+        storeParameter(m_parameterMins.size(), param.value);
+        m_parameterMins.append(param.min);
+        m_parameterMaxs.append(param.max);
+    }
+    m_changedParameters.clear();
+    m_isParameterChanged = QVector<bool>(m_parameterCount, false);
+    m_values = QVector<Value>(m_template->names().size());
+    m_bindingValues.clear();
+    foreach (const Binding &binding, m_template->bindings()) {
+        m_bindingValues.append(binding.value);
+    }
+    m_dirtyExpressions = QVector<bool>(m_template->expressions().size(), false);
+    m_dirtyBindings = QVector<bool>(m_bindingValues.size(), false);
+    m_isBindingStale = QVector<bool>(m_bindingValues.size(), false);
+    updateNativePaths();
+    m_renderBuffer.clear();
+    m_renderBuffer.reserve(m_template->renderSize() + m_template->renderSize() / 4);
+
+    //Выражения вне подмножества встроенного вычислителя
+    //компилируются в новом движке JS при первом обращении
+    resetJsEngine();
+}
+
+/*!
+  * Copy parameters and evaluated values of another document without
+  * evaluation. The template is shared, the JavaScript engine is created
+  * again on demand, and the error log is empty.
+  *
+  * \param[in] other source document
+  */
+void ParametricSvgDocument::copyFrom(const ParametricSvgDocument &other)
+{
+    if(this == &other){
+        return;
+    }
+    resetJsEngine();
+    m_template = other.m_template;
+    m_namespace = other.m_namespace;
+    m_diagnostics.clear();
+
+    m_parameterCount = other.m_parameterCount;
+    m_parameterNumbers = other.m_parameterNumbers;
+    m_parameterVariants = other.m_parameterVariants;
+    m_isNumberParameter = other.m_isNumberParameter;
+    m_parameterMins = other.m_parameterMins;
+    m_parameterMaxs = other.m_parameterMaxs;
+    m_changedParameters = other.m_changedParameters;
+    m_isParameterChanged = other.m_isParameterChanged;
+    m_values = other.m_values;
+    m_bindingValues = other.m_bindingValues;
+    m_dirtyExpressions = other.m_dirtyExpressions;
+    m_dirtyBindings = other.m_dirtyBindings;
+
+    m_evaluationBudget = other.m_evaluationBudget;
+    m_updateBudget = other.m_updateBudget;
+    m_isOverrun = other.m_isOverrun;
+    m_isFullEvaluationRequired = other.m_isFullEvaluationRequired;
+
+    m_isInstancingEnabled = other.m_isInstancingEnabled;
+    m_instancing = other.m_instancing;
+    m_nativePaths = other.m_nativePaths;
+    m_nativePathIndices = other.m_nativePathIndices;
+    m_isBindingStale = other.m_isBindingStale;
+    m_isOverlayChanged = other.m_isOverlayChanged;
+
+    setStatsEnabled(other.isStatsEnabled());
+    resetStats();
+    m_renderBuffer.clear();
+    if(!m_template.isNull()){
+        m_renderBuffer.reserve(m_template->renderSize() + m_template->renderSize() / 4);
+    }
+}
+
+QSharedPointer<const ParametricSvgTemplate> ParametricSvgDocument::svgTemplate() const
+{
+    return m_template;
+}
+
+/*!
+  * Check that the content is not loaded
+  *
+  * \return true, if there is no template
+  */
+bool ParametricSvgDocument::isNull() const
+{
+    return m_template.isNull();
+}
+
+QString ParametricSvgDocument::namespaceName() const
+{
+    return m_namespace;
+}
+
+/*!
+  * Assemble SVG from static fragments and current values of bindings
+  * in the reusable buffer, without serializing the whole document
+  *
+  * \return evaluated SVG document. It is valid until the next call
+  */
+const QByteArray &ParametricSvgDocument::toSvg()
+{
+    evaluateStaleBindings();
+    ParametricSvgPhase phase(m_stats ? &m_stats->serializeTime : nullptr, "toSvg");
+    return assemble(m_template->renderSegments());
+}
+
+/*!
+  * Assemble overlay of instancing: elements depending on parameters
+  * without the static part of the template
+  *
+  * \return evaluated overlay. It is valid until the next call.
+  * Empty, if the template can not be split
+  */
+const QByteArray &ParametricSvgDocument::toInstanceSvg()
+{
+    const ParametricSvgTemplate::Instancing &instancing = m_template->instancing();
+    if(!instancing.isValid){
+        m_renderBuffer.resize(0);
+        return m_renderBuffer;
+    }
+    ParametricSvgPhase phase(m_stats ? &m_stats->serializeTime : nullptr, "toInstanceSvg");
+    return assemble(instancing.overlaySegments);
+}
+
+/*!
+  * Enable instancing. Paths of the template, which are drawn without
+  * QSvgRenderer, are evaluated into QPainterPath by their numeric slots,
+  * and their values in SVG are updated only on the next call of toSvg().
+  *
+  * \param[in] isEnabled true to evaluate native paths
+  */
+void ParametricSvgDocument::setInstancingEnabled(bool isEnabled)
+{
+    if(m_isInstancingEnabled == isEnabled){
+        return;
+    }
+    m_isInstancingEnabled = isEnabled;
+    evaluateStaleBindings();
+    updateNativePaths();
+    for (int i = 0; i < m_nativePathIndices.size(); ++i) {
+        if(m_nativePathIndices.at(i) >= 0){
+            evaluateNativePath(i, m_nativePathIndices.at(i));
+        }
+    }
+}
+
+bool ParametricSvgDocument::isInstancingEnabled() const
+{
+    return m_isInstancingEnabled;
+}
+
+/*!
+  * Check whether the last update changed values in the overlay of instancing.
+  * If only native paths are changed, the overlay does not need to be loaded again.
+  *
+  * \return true, if values of the overlay were evaluated
+  */
+bool ParametricSvgDocument::isOverlayChanged() const
+{
+    return m_isOverlayChanged;
+}
+
+/*!
+  * Get native paths of instancing for the current values
+  *
+  * \return paths in the order of ParametricSvgTemplate::Instancing::nativePaths
+  */
+QVector<QPainterPath> ParametricSvgDocument::nativePaths()
+{
+    QVector<QPainterPath> paths;
+    paths.reserve(m_nativePaths.size());
+    for (int i = 0; i < m_nativePaths.size(); ++i) {
+        paths.append(m_nativePaths[i].path());
+    }
+    return paths;
+}
+
+/*!
+  * Copy compiled native paths of the template, if instancing is enabled
+  */
+void ParametricSvgDocument::updateNativePaths()
+{
+    m_instancing = nullptr;
+    m_nativePaths.clear();
+    m_nativePathIndices.clear();
+    if(!m_isInstancingEnabled || m_template.isNull()){
+        return;
+    }
+    const ParametricSvgTemplate::Instancing &instancing = m_template->instancing();
+    if(!instancing.isValid){
+        return;
+    }
+    m_instancing = &instancing;
+    m_nativePathIndices = QVector<int>(m_template->bindings().size(), -1);
+    for (int i = 0; i < instancing.nativePaths.size(); ++i) {
+        m_nativePaths.append(instancing.nativePaths.at(i).path);
+        m_nativePathIndices[instancing.nativePaths.at(i).binding] = i;
+    }
+}
+
+/*!
+  * Assemble SVG from fragments and current values of bindings
+  *
+  * \param[in] segments static fragments
+  * \return reusable buffer with SVG
+  */
+const QByteArray &ParametricSvgDocument::assemble(const QVector<RenderSegment> &segments)
+{
+    //resize(0) сохраняет зарезервированную память буфера
+    m_renderBuffer.resize(0);
+    foreach (const RenderSegment &segment, segments) {
+        m_renderBuffer.append(segment.data);
+        if (segment.binding >= 0) {
+            appendEscaped(m_renderBuffer, m_bindingValues.at(segment.binding));
+        }
+    }
+    if(m_stats){
+        m_stats->bytesSerialized += m_renderBuffer.size();
+    }
+    return m_renderBuffer;
+}
+
+/*!
+  * Build key of the render cache from the template and parameter values
+  *
+  * \return cache key
+  */
+QByteArray ParametricSvgDocument::renderKey() const
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << m_template->id();
+    //Имена не нужны: номера параметров одинаковы для всех документов шаблона
+    for (int i = 0; i < m_parameterCount; ++i) {
+        if(m_isNumberParameter.at(i)){
+            stream << m_parameterNumbers.at(i);
+        }else{
+            stream << m_parameterVariants.at(i);
+        }
+    }
+    return key;
+}
+
+/*!
+  * Append value to SVG buffer in UTF-8 with XML escaping
+  *
+  * \param[in,out] buffer SVG buffer
+  * \param[in] value attribute or text value
+  */
+void ParametricSvgDocument::appendEscaped(QByteArray &buffer, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    for (int i = 0; i < utf8.size(); ++i) {
+        const char c = utf8.at(i);
+        switch (c) {
+        case '&': buffer.append("&amp;"); break;
+        case '<': buffer.append("&lt;"); break;
+        case '>': buffer.append("&gt;"); break;
+        case '"': buffer.append("&quot;"); break;
+        case '\n': buffer.append("&#xa;"); break;
+        case '\r': buffer.append("&#xd;"); break;
+        case '\t': buffer.append("&#x9;"); break;
+        default: buffer.append(c); break;
+        }
+    }
+}
+
+/*!
+  * Drop JavaScript engine and everything compiled by it
+  */
+void ParametricSvgDocument::resetJsEngine()
+{
+    m_expressionFunctions.clear();
+    m_bindingFunctions.clear();
+
+    delete m_jsEngine;
+    m_jsEngine = nullptr;
+}
+
+/*!
+  * Get JavaScript engine for sources outside the native subset.
+  * The engine is created on the first call with all current values as global variables.
+  *
+  * \return link to JavaScript Engine
+  */
+QJSEngine *ParametricSvgDocument::jsEngine()
+{
+    if(m_jsEngine){
+        return m_jsEngine;
+    }
+
+    m_jsEngine = new QJSEngine();
+    if(m_template.isNull()){
+        return m_jsEngine;
+    }
+    compileFunctions();
+
+    QJSValue globalObj = m_jsEngine->globalObject();
+    const QStringList &names = m_template->names();
+    for (int i = 0; i < m_values.size(); ++i) {
+        if(!m_values.at(i).isUndefined()){
+            globalObj.setProperty(names.at(i), toScriptValue(m_values.at(i)));
+        }
+    }
+    return m_jsEngine;
+}
+
+/*!
+  * Compile expressions and templates of attributes, which are not
+  * compiled by the native evaluator
+  */
+void ParametricSvgDocument::compileFunctions()
+{
+    foreach (const Expression &exp, m_template->expressions()) {
+        m_expressionFunctions.append(exp.native.isValid()
+                                     ? QJSValue()
+                                     : ParametricSvgTemplate::compileSource(m_jsEngine, exp.value));
+    }
+
+    QHash<QString, QJSValue> compiled;
+    foreach (const Binding &binding, m_template->bindings()) {
+        if(binding.native.isValid()){
+            m_bindingFunctions.append(QJSValue());
+            continue;
+        }
+        if(!compiled.contains(binding.source)){
+            compiled.insert(binding.source, ParametricSvgTemplate::compileSource(m_jsEngine, binding.source));
+        }
+        m_bindingFunctions.append(compiled.value(binding.source));
+    }
+}
+
+/*!
+  * Set value of parameter or expression and the equivalent JavaScript variable
+  *
+  * \param[in] index index in the name table of the template
+  * \param[in] value new value
+  */
+void ParametricSvgDocument::setValue(int index, const ParametricExpression::Value &value)
+{
+    m_values[index] = value;
+    if(m_jsEngine){
+        m_jsEngine->globalObject().setProperty(m_template->names().at(index), toScriptValue(value));
+    }
+}
+
+/*!
+  * Read values of all JavaScript variables with known names after a script,
+  * which could change any of them
+  */
+void ParametricSvgDocument::readJsValues()
+{
+    if(!m_jsEngine){
+        return;
+    }
+    QJSValue globalObj = m_jsEngine->globalObject();
+    const QStringList &names = m_template->names();
+    for (int i = 0; i < names.size(); ++i) {
+        if(globalObj.hasProperty(names.at(i))){
+            m_values[i] = fromScriptValue(globalObj.property(names.at(i)));
+        }
+    }
+}
+
+/*!
+  * Call compiled function or evaluate the source, if it was not compiled
+  *
+  * \param[in] jsEngine link to JavaScript Engine
+  * \param[in] function compiled function
+  * \param[in] source JavaScript source of the function
+  * \return result of evaluation
+  */
+QJSValue ParametricSvgDocument::callCompiled(QJSEngine *jsEngine, const QJSValue &function, const QString &source)
+{
+    //Срок вычисления не позже срока всего обновления
+    QDeadlineTimer deadline = m_updateDeadline;
+    if(m_evaluationBudget > 0){
+        QDeadlineTimer evaluationDeadline(m_evaluationBudget);
+        if(evaluationDeadline < deadline){
+            deadline = evaluationDeadline;
+        }
+    }
+    if(deadline.isForever()){
+        return function.isCallable() ? function.call() : jsEngine->evaluate(source);
+    }
+
+    ParametricSvgWatchdog::instance()->arm(jsEngine, deadline);
+    QJSValue result = function.isCallable() ? function.call() : jsEngine->evaluate(source);
+    ParametricSvgWatchdog::instance()->disarm(jsEngine);
+
+    if(jsEngine->isInterrupted()){
+        jsEngine->setInterrupted(false);
+        m_isOverrun = true;
+        return jsEngine->newErrorObject(QJSValue::RangeError,
+                                        QString("Evaluation of '%1' exceeded the time budget").arg(source));
+    }
+    return result;
+}
+
+/*!
+  * Evaluate parameters, expressions and string templates in SVG document
+  */
+void ParametricSvgDocument::evaluateAll()
+{
+    for (int i = 0; i < m_parameterCount; ++i) {
+        markParameterChanged(i);
+    }
+    m_dirtyExpressions.fill(true);
+    m_dirtyBindings.fill(true);
+    evaluateDirty();
+}
+
+/*!
+  * Evaluate only expressions and string templates depending on changed parameters
+  */
+void ParametricSvgDocument::evaluateChanged()
+{
+    if(m_template.isNull()){
+        return;
+    }
+    if(m_isFullEvaluationRequired){
+        evaluateAll();
+        return;
+    }
+    QSet<QString> names;
+    foreach (int handle, m_changedParameters) {
+        names.insert(parameterName(handle));
+    }
+    m_template->markDependents(names, m_dirtyExpressions, m_dirtyBindings);
+    evaluateDirty();
+}
+
+/*!
+  * Evaluate changed parameters, dirty expressions and dirty string templates
+  */
+void ParametricSvgDocument::evaluateDirty()
+{
+    //Движок JS привязан к потоку, в котором создан
+    if(m_jsEngine && m_jsEngine->thread() != QThread::currentThread()){
+        resetJsEngine();
+    }
+
+    //Ошибки относятся к последнему обновлению
+    m_diagnostics.beginGeneration();
+    m_isOverrun = false;
+    m_isOverlayChanged = false;
+    m_isUpdateExpired = false;
+    m_isFullEvaluationRequired = false;
+    m_updateDeadline = m_updateBudget > 0
+            ? QDeadlineTimer(m_updateBudget)
+            : QDeadlineTimer(QDeadlineTimer::Forever);
+
+    {
+        ParametricSvgPhase phase(m_stats ? &m_stats->parametersTime : nullptr, "evaluateParameters");
+        evaluateParameters();
+    }
+    {
+        ParametricSvgPhase phase(m_stats ? &m_stats->expressionsTime : nullptr, "evaluateExpressions");
+        evaluateExpressions();
+    }
+    {
+        ParametricSvgPhase phase(m_stats ? &m_stats->bindingsTime : nullptr, "evaluateXmlDocument");
+        evaluateXmlDocument();
+    }
+
+    foreach (int handle, m_changedParameters) {
+        m_isParameterChanged[handle] = false;
+    }
+    m_changedParameters.clear();
+    m_dirtyExpressions.fill(false);
+    m_dirtyBindings.fill(false);
+
+    //Прерванные и пропущенные вычисления повторяются целиком
+    m_isFullEvaluationRequired = m_isOverrun;
+    m_updateDeadline = QDeadlineTimer(QDeadlineTimer::Forever);
+}
+
+/*!
+  * Evaluate changed parameters and set their values in the environment
+  */
+void ParametricSvgDocument::evaluateParameters()
+{
+    const QHash<QString, int> &nameIndex = m_template->nameIndex();
+
+    //Номер параметра совпадает с индексом в таблице имён
+    foreach (int index, m_changedParameters) {
+        if (m_isNumberParameter.at(index)) {
+            setValue(index, Value::fromNumber(m_parameterNumbers.at(index)));
+            continue;
+        }
+
+        const QVariant &value = m_parameterVariants.at(index);
+        if (value.type() != QVariant::String || !isTemplateString(value.toString())){
+            //Значение передаётся без повторного разбора
+            setValue(index, Value::fromVariant(value));
+            continue;
+        }
+        if (isUpdateExpired()) {
+            break;
+        }
+
+        const QString literal = QString("`%1`").arg(value.toString());
+        ParametricExpression native;
+        if (native.compile(literal, nameIndex)) {
+            Value result;
+            QString error;
+            bool isOk = native.evaluate(m_values, &result, &error);
+            if(m_stats){
+                ++m_stats->nativeEvaluations;
+            }
+            if(isOk){
+                setValue(index, result);
+            }else{
+                addError(ParametricSvgDiagnostic::ParameterSite, index, literal, error);
+            }
+            continue;
+        }
+
+        QJSValue jsValue = callCompiled(jsEngine(), QJSValue(), literal);
+        if(m_stats){
+            ++m_stats->jsEvaluations;
+        }
+        if(!jsValue.isError()){
+            m_jsEngine->globalObject().setProperty(parameterName(index), jsValue);
+            m_values[index] = fromScriptValue(jsValue);
+        }else{
+            addError(ParametricSvgDiagnostic::ParameterSite, index, literal, jsValue.property("message").toString());
+        }
+    }
+}
+
+/*!
+  * Evaluate dirty expressions and set their values in the environment
+  */
+void ParametricSvgDocument::evaluateExpressions()
+{
+    const QList<Expression> &expressions = m_template->expressions();
+    QVector<int> writtenIndices;
+    bool isDynamic = false;
+    for (int i = 0; i < expressions.size(); ++i) {
+        if (!m_dirtyExpressions.at(i)) {
+            continue;
+        }
+        if (isUpdateExpired()) {
+            break;
+        }
+        const Expression &exp = expressions.at(i);
+        writtenIndices.append(exp.nameIndex);
+        isDynamic = isDynamic || exp.isDynamic;
+
+        if (exp.native.isValid()) {
+            Value result;
+            QString error;
+            bool isOk = exp.native.evaluate(m_values, &result, &error);
+            if(m_stats){
+                ++m_stats->nativeEvaluations;
+            }
+            if(isOk){
+                setValue(exp.nameIndex, result);
+            }else{
+                addError(ParametricSvgDiagnostic::ExpressionSite, i, exp.value, error);
+            }
+            continue;
+        }
+
+        QJSEngine *engine = jsEngine();
+        QJSValue jsValue = callCompiled(engine, m_expressionFunctions.at(i), exp.value);
+        if(m_stats){
+            ++m_stats->jsEvaluations;
+        }
+
+        if(!jsValue.isError()){
+            engine->globalObject().setProperty(exp.name, jsValue);
+            m_values[exp.nameIndex] = fromScriptValue(jsValue);
+        }else{
+            addError(ParametricSvgDiagnostic::ExpressionSite, i, exp.value, jsValue.property("message").toString());
+        }
+
+        //Скрипт мог изменить любые переменные
+        if(exp.isDynamic){
+            readJsValues();
+        }
+    }//for
+
+    //Обновить значения параметров, если они вычислялись в выражениях
+    if(isDynamic){
+        writtenIndices.clear();
+        for (int i = 0; i < m_parameterCount; ++i) {
+            writtenIndices.append(i);
+        }
+    }
+    expressionValuesToParameterValues(writtenIndices);
+}
+
+/*!
+  * Copy values of expressions back to parameters with the same names
+  *
+  * \param[in] indices indices of variables that could be changed
+  */
+void ParametricSvgDocument::expressionValuesToParameterValues(const QVector<int> &indices)
+{
+    foreach (int index, indices) {
+        //Выражение, не совпадающее по имени с параметром
+        if(index < 0 || index >= m_parameterCount){
+            continue;
+        }
+
+        const Value &value = m_values.at(index);
+        if(value.type == Value::Number && m_isNumberParameter.at(index)){
+            if(m_parameterNumbers.at(index) != value.number)
+                setParameter(index, value.number);
+            continue;
+        }
+        QVariant variantValue = value.toVariant();
+        if(variantValue.isValid() && parameterValue(index) != variantValue)
+            setParameter(index, variantValue);
+    }//foreach
+}
+
+/*!
+  * Evaluate dirty tamplates string from the binding table
+  */
+void ParametricSvgDocument::evaluateXmlDocument()
+{
+    for (int i = 0; i < m_dirtyBindings.size(); ++i) {
+        if (!m_dirtyBindings.at(i)) {
+            continue;
+        }
+        if (isUpdateExpired()) {
+            break;
+        }
+        const int pathIndex = m_nativePathIndices.isEmpty() ? -1 : m_nativePathIndices.at(i);
+        if (pathIndex >= 0) {
+            evaluateNativePath(i, pathIndex);
+            continue;
+        }
+        evaluateBinding(i);
+        m_isOverlayChanged = true;
+    }
+}
+
+/*!
+  * Evaluate string value of binding
+  *
+  * \param[in] index index of binding
+  * \return false on error. The previous value is kept
+  */
+bool ParametricSvgDocument::evaluateBinding(int index)
+{
+    const Binding &binding = m_template->bindings().at(index);
+
+    if (binding.native.isValid()) {
+        Value result;
+        QString error;
+        bool isOk = binding.native.evaluate(m_values, &result, &error);
+        if(!isOk){
+            addError(ParametricSvgDiagnostic::AttributeSite, index, binding.source, error);
+        }
+        if(m_stats){
+            ++m_stats->nativeEvaluations;
+            m_stats->attributesPatched += isOk ? 1 : 0;
+        }
+        if(isOk){
+            m_bindingValues[index] = result.toString();
+            m_isBindingStale[index] = false;
+        }
+        return isOk;
+    }
+
+    QJSEngine *engine = jsEngine();
+    QJSValue jsResult = callCompiled(engine, m_bindingFunctions.at(index), binding.source);
+    if(m_stats){
+        ++m_stats->jsEvaluations;
+    }
+
+    if(jsResult.isError()){
+        addError(ParametricSvgDiagnostic::AttributeSite, index, binding.source, jsResult.property("message").toString());
+        return false;
+    }
+    if(m_stats){
+        ++m_stats->attributesPatched;
+    }
+
+    m_bindingValues[index] = jsResult.toString();
+    m_isBindingStale[index] = false;
+    return true;
+}
+
+/*!
+  * Evaluate native path by its numeric slots. Paths without slots
+  * and paths, whose slots are not numbers, are parsed from the string value.
+  *
+  * \param[in] binding index of binding of the `d` attribute
+  * \param[in] pathIndex index of native path
+  */
+void ParametricSvgDocument::evaluateNativePath(int binding, int pathIndex)
+{
+    const ParametricSvgPath &program = m_instancing->nativePaths.at(pathIndex).path;
+    ParametricSvgPath &path = m_nativePaths[pathIndex];
+    if(program.isCompiled()){
+        //После разбора строки путь снова вычисляется по ячейкам
+        if(!path.isCompiled()){
+            path = program;
+        }
+        QString error;
+        if(path.evaluate(m_values, &error)){
+            m_isBindingStale[binding] = true;
+            if(m_stats){
+                ++m_stats->nativeEvaluations;
+                ++m_stats->attributesPatched;
+            }
+            return;
+        }
+    }
+
+    if(evaluateBinding(binding) && !path.parse(m_bindingValues.at(binding))){
+        addError(ParametricSvgDiagnostic::AttributeSite, binding, m_template->bindings().at(binding).source,
+                 QString("Invalid path data '%1'").arg(m_bindingValues.at(binding)));
+    }
+}
+
+/*!
+  * Evaluate string values of native paths for serialization
+  */
+void ParametricSvgDocument::evaluateStaleBindings()
+{
+    for (int i = 0; i < m_isBindingStale.size(); ++i) {
+        if(m_isBindingStale.at(i)){
+            evaluateBinding(i);
+        }
+    }
+}
+
+/*!
+  * Check whether string parameter must be evaluated as JavaScript template literal
+  *
+  * \param[in] value string value of parameter
+  * \return true if the string contains substitutions, escapes or backquotes
+  */
+bool ParametricSvgDocument::isTemplateString(const QString &value)
+{
+    return value.contains(QLatin1String("${"))
+            || value.contains(QLatin1Char('\\'))
+            || value.contains(QLatin1Char('`'));
+}
+
+/*!
+  * Set parameter value
+  *
+  * \param[in] pName paramter name
+  * \param[in] value parameter value
+  * \return true in success
+  */
+bool ParametricSvgDocument::setParameter(const QString &pName, QVariant value)
+{
+    if(pName.isEmpty()){
+        return false;
+    }
+    return setParameter(parameterHandle(pName), value);
+}
+
+/*!
+  * Get handle of parameter for fast access without name lookups.
+  * Handles are valid until the next setContent().
+  *
+  * \param[in] pName parameter name
+  * \return handle. -1, if the parameter does not exist
+  */
+int ParametricSvgDocument::parameterHandle(const QString &pName) const
+{
+    if(m_template.isNull()){
+        return -1;
+    }
+    //Параметры занимают начало таблицы имён
+    int index = m_template->nameIndex().value(pName, -1);
+    return index < m_parameterCount ? index : -1;
+}
+
+/*!
+  * Set number value of parameter by handle
+  *
+  * \param[in] handle parameter handle
+  * \param[in] value parameter value
+  * \return true in success
+  */
+bool ParametricSvgDocument::setParameter(int handle, double value)
+{
+    if(handle < 0 || handle >= m_parameterCount){
+        return false;
+    }
+    if(!isNumberValueInRange(handle, value)){
+        return false;
+    }
+    m_parameterNumbers[handle] = value;
+    if(!m_isNumberParameter.at(handle)){
+        m_isNumberParameter[handle] = true;
+        m_parameterVariants[handle] = QVariant();
+    }
+    markParameterChanged(handle);
+    return true;
+}
+
+/*!
+  * Set parameter value by handle
+  *
+  * \param[in] handle parameter handle
+  * \param[in] value parameter value
+  * \return true in success
+  */
+bool ParametricSvgDocument::setParameter(int handle, const QVariant &value)
+{
+    if(handle < 0 || handle >= m_parameterCount){
+        return false;
+    }
+    if(!value.isValid() || value.isNull()){
+        return false;
+    }
+    if(isNumberType(value)){
+        return setParameter(handle, value.toDouble());
+    }
+    if(value.type() != QVariant::String && !isNumberValueInRange(handle, value.toReal())){
+        return false;
+    }
+    storeParameter(handle, value);
+    markParameterChanged(handle);
+    return true;
+}
+
+/*!
+  * Get number value of parameter by handle
+  *
+  * \param[in] handle parameter handle
+  * \return value. 0, if the parameter is not a number
+  */
+double ParametricSvgDocument::parameterNumber(int handle) const
+{
+    if(handle < 0 || handle >= m_parameterCount || !m_isNumberParameter.at(handle)){
+        return 0.0;
+    }
+    return m_parameterNumbers.at(handle);
+}
+
+/*!
+  * Get parameter value by handle
+  *
+  * \param[in] handle parameter handle
+  * \return QVariant value
+  */
+QVariant ParametricSvgDocument::parameterValue(int handle) const
+{
+    if(handle < 0 || handle >= m_parameterCount){
+        return QVariant();
+    }
+    if(m_isNumberParameter.at(handle)){
+        return QVariant(m_parameterNumbers.at(handle));
+    }
+    return m_parameterVariants.at(handle);
+}
+
+/*!
+  * Get parameter name by handle
+  *
+  * \param[in] handle parameter handle
+  * \return name. An empty string, if the handle is not valid
+  */
+QString ParametricSvgDocument::parameterName(int handle) const
+{
+    if(handle < 0 || handle >= m_parameterCount){
+        return QString();
+    }
+    return m_template->names().at(handle);
+}
+
+/*!
+  * Store value without checks and marking the parameter changed
+  *
+  * \param[in] handle parameter handle
+  * \param[in] value parameter value
+  */
+void ParametricSvgDocument::storeParameter(int handle, const QVariant &value)
+{
+    if(isNumberType(value)){
+        m_isNumberParameter[handle] = true;
+        m_parameterNumbers[handle] = value.toDouble();
+        m_parameterVariants[handle] = QVariant();
+    }else{
+        m_isNumberParameter[handle] = false;
+        m_parameterVariants[handle] = value;
+    }
+}
+
+void ParametricSvgDocument::markParameterChanged(int handle)
+{
+    if(!m_isParameterChanged.at(handle)){
+        m_isParameterChanged[handle] = true;
+        m_changedParameters.append(handle);
+    }
+}
+
+/*!
+  * Restore default values of all parameters from the template
+  */
+void ParametricSvgDocument::resetParameters()
+{
+    if(m_template.isNull()){
+        return;
+    }
+    int handle = 0;
+    QMap<QString, Parameter>::const_iterator i = m_template->parameters().constBegin();
+    for (; i != m_template->parameters().constEnd(); ++i, ++handle) {
+        if(parameterValue(handle) != i.value().value){
+            storeParameter(handle, i.value().value);
+            markParameterChanged(handle);
+        }
+    }
+}
+
+/*!
+  * Get values of parameters changed after the last evaluation and forget the changes.
+  * Used to pass the changes to another document with the same template.
+  *
+  * \return parameter values by names
+  */
+QVariantMap ParametricSvgDocument::takeChangedParameters()
+{
+    QVariantMap values;
+    foreach (int handle, m_changedParameters) {
+        values.insert(parameterName(handle), parameterValue(handle));
+        m_isParameterChanged[handle] = false;
+    }
+    m_changedParameters.clear();
+    return values;
+}
+
+/*!
+  * Set parameter values evaluated by another document with the same template.
+  * The values are not marked as changed.
+  *
+  * \param[in] values parameter values by names
+  */
+void ParametricSvgDocument::assignEvaluatedValues(const QVariantMap &values)
+{
+    QVariantMap::const_iterator i = values.constBegin();
+    for (; i != values.constEnd(); ++i) {
+        int handle = parameterHandle(i.key());
+        if(handle >= 0 && !m_isParameterChanged.at(handle)){
+            storeParameter(handle, i.value());
+        }
+    }
+}
+
+/*!
+  * Check whether parameters were changed after the last evaluation
+  *
+  * \return true, if evaluateChanged() is required
+  */
+bool ParametricSvgDocument::hasChanges() const
+{
+    return !m_changedParameters.isEmpty();
+}
+
+/*!
+  * Save values of all parameters into a binary snapshot
+  *
+  * \return snapshot for restoreParameters()
+  */
+QByteArray ParametricSvgDocument::saveParameters() const
+{
+    QByteArray snapshot;
+    QDataStream stream(&snapshot, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << SnapshotMagic << SnapshotVersion << quint32(m_parameterCount);
+    //Имена позволяют применить снимок к изменённому шаблону
+    for (int i = 0; i < m_parameterCount; ++i) {
+        stream << parameterName(i) << m_isNumberParameter.at(i);
+        if(m_isNumberParameter.at(i)){
+            stream << m_parameterNumbers.at(i);
+        }else{
+            stream << m_parameterVariants.at(i);
+        }
+    }
+    return snapshot;
+}
+
+/*!
+  * Set parameters from a snapshot made by saveParameters(). Only values,
+  * which differ from the current ones, are marked as changed, and they
+  * are evaluated by the next evaluateChanged().
+  *
+  * \param[in] snapshot binary snapshot
+  * \return false, if the snapshot is damaged or has another version,
+  * or some values are not set: unknown parameters or values out of range
+  */
+bool ParametricSvgDocument::restoreParameters(const QByteArray &snapshot)
+{
+    if(m_template.isNull()){
+        return false;
+    }
+    QDataStream stream(snapshot);
+    stream.setVersion(QDataStream::Qt_5_6);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if(stream.status() != QDataStream::Ok || magic != SnapshotMagic || version != SnapshotVersion){
+        return false;
+    }
+
+    //Снимок читается целиком, чтобы повреждённый не применялся частично
+    QVector<int> handles;
+    QVector<double> numbers;
+    QVector<QVariant> variants;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        bool isNumber = false;
+        double number = 0.0;
+        QVariant variant;
+        stream >> name >> isNumber;
+        if(isNumber){
+            stream >> number;
+        }else{
+            stream >> variant;
+        }
+        handles.append(parameterHandle(name));
+        numbers.append(number);
+        variants.append(isNumber ? QVariant() : variant);
+    }
+    if(stream.status() != QDataStream::Ok){
+        return false;
+    }
+
+    bool isAllSet = true;
+    for (int i = 0; i < handles.size(); ++i) {
+        const int handle = handles.at(i);
+        if(handle < 0){
+            isAllSet = false;
+            continue;
+        }
+        if(!variants.at(i).isValid()){
+            if(!m_isNumberParameter.at(handle) || m_parameterNumbers.at(handle) != numbers.at(i)){
+                isAllSet = setParameter(handle, numbers.at(i)) && isAllSet;
+            }
+        }else if(m_isNumberParameter.at(handle) || m_parameterVariants.at(handle) != variants.at(i)){
+            isAllSet = setParameter(handle, variants.at(i)) && isAllSet;
+        }
+    }
+    return isAllSet;
+}
+
+bool ParametricSvgDocument::isNumberValueInRange(int handle, double value) const
+{
+    if(value >= m_parameterMins.at(handle)
+            && value <= m_parameterMaxs.at(handle)){
+        return true;
+    }
+    return false;
+}
+
+/*!
+  * Check whether the value is stored in the array of numbers
+  *
+  * \param[in] value parameter value
+  * \return true for numeric types
+  */
+bool ParametricSvgDocument::isNumberType(const QVariant &value)
+{
+    switch (static_cast<int>(value.type())) {
+    case QMetaType::Double:
+    case QMetaType::Float:
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+  * Add error of the current update to the log
+  *
+  * \param[in] site kind of the source
+  * \param[in] index index of parameter, expression or attribute
+  * \param[in] source evaluated source
+  * \param[in] message error message
+  */
+void ParametricSvgDocument::addError(ParametricSvgDiagnostic::Site site, int index, const QString &source, const QString &message)
+{
+    m_diagnostics.report(site, index, source, message);
+    if(m_stats){
+        ++m_stats->errors;
+    }
+}
+
+/*!
+  * Return parameter value type
+  *
+  * \param[in] pName parameter name
+  * \return QVariant::Type
+  */
+QVariant::Type ParametricSvgDocument::parameterType(const QString &pName) const
+{
+    int handle = parameterHandle(pName);
+    if(handle < 0){
+        return QVariant::Invalid;
+    }
+    if(m_isNumberParameter.at(handle)){
+        return QVariant::Double;
+    }
+    return m_parameterVariants.at(handle).type();
+}
+
+/*!
+  * Return parameter value
+  *
+  * \param[in] pName parameter name
+  * \return QVariant value
+  */
+QVariant ParametricSvgDocument::parameterValue(const QString &pName) const
+{
+    return parameterValue(parameterHandle(pName));
+}
+
+/*!
+  * Return parameter value minimal limit
+  *
+  * \param[in] pName parameter name
+  * \return minimal limit
+  */
+qreal ParametricSvgDocument::parameterMin(const QString &pName) const
+{
+    int handle = parameterHandle(pName);
+    if(handle >= 0){
+        return m_parameterMins.at(handle);
+    }
+    return 0.0;
+}
+
+/*!
+  * Return parameter value maximal limit
+  *
+  * \param[in] pName parameter name
+  * \return maximal limit
+  */
+qreal ParametricSvgDocument::parameterMax(const QString &pName) const
+{
+    int handle = parameterHandle(pName);
+    if(handle >= 0){
+        return m_parameterMaxs.at(handle);
+    }
+    return 0.0;
+}
+
+/*!
+  * Check if the parameter exist in the document
+  *
+  * \param[in] pName parameter name
+  * \return true, if the parameter exist in the document
+  */
+bool ParametricSvgDocument::parameterIsExist(const QString &pName) const
+{
+    return parameterHandle(pName) >= 0;
+}
+
+/*!
+  * Get values of all parameters
+  *
+  * \return parameter values by names
+  */
+QVariantMap ParametricSvgDocument::parameterValues() const
+{
+    QVariantMap values;
+    for (int i = 0; i < m_parameterCount; ++i) {
+        values.insert(parameterName(i), parameterValue(i));
+    }
+    return values;
+}
+
+/*!
+  * Get list of all parameter names
+  *
+  * \return list of names
+  */
+QStringList ParametricSvgDocument::parameterNames() const
+{
+    if(m_template.isNull()){
+        return QStringList();
+    }
+    return m_template->names().mid(0, m_parameterCount);
+}
+
+/*!
+  * Get number of all parameters
+  *
+  * \return number of
+  */
+int ParametricSvgDocument::parametersCount() const
+{
+    return m_parameterCount;
+}
+
+/*!
+  * Check whether the last update had errors
+  *
+  * \return true, if there were errors
+  */
+bool ParametricSvgDocument::isError() const
+{
+    return m_diagnostics.hasCurrent();
+}
+
+/*!
+  * Get messages of errors of the last update
+  *
+  * \return list of messages
+  */
+QStringList ParametricSvgDocument::errors() const
+{
+    QStringList messages;
+    foreach (const ParametricSvgDiagnostic &diagnostic, m_diagnostics.current()) {
+        messages.append(diagnostic.message);
+    }
+    return messages;
+}
+
+/*!
+  * Get log of errors with their sources and repetitions
+  *
+  * \return log of errors
+  */
+ParametricSvgDiagnostics &ParametricSvgDocument::diagnostics()
+{
+    return m_diagnostics;
+}
+
+const ParametricSvgDiagnostics &ParametricSvgDocument::diagnostics() const
+{
+    return m_diagnostics;
+}
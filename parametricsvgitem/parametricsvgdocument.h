@@ -0,0 +1,174 @@
+#ifndef PARAMETRICSVGDOCUMENT_H
+#define PARAMETRICSVGDOCUMENT_H
+
+
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QJSValue>
+#include <QSet>
+#include <QSharedPointer>
+#include "parametricsvgdiagnostics.h"
+#include "parametricsvgstats.h"
+#include "parametricsvgtemplate.h"
+
+class QJSEngine;
+
+class ParametricSvgDocument
+{
+private:
+    typedef ParametricSvgTemplate::Parameter Parameter;
+    typedef ParametricSvgTemplate::Expression Expression;
+    typedef ParametricSvgTemplate::Binding Binding;
+    typedef ParametricSvgTemplate::RenderSegment RenderSegment;
+    typedef ParametricExpression::Value Value;
+
+    //Общий неизменяемый шаблон
+    QSharedPointer<const ParametricSvgTemplate> m_template;
+    //Размеры компонента: массивы по номерам параметров, совпадающим
+    //с индексами таблицы имён шаблона
+    int m_parameterCount;
+    QVector<double> m_parameterNumbers;
+    //Значения, не являющиеся числами: строки, логические и т.п.
+    QVector<QVariant> m_parameterVariants;
+    QVector<bool> m_isNumberParameter;
+    QVector<double> m_parameterMins;
+    QVector<double> m_parameterMaxs;
+    //Значения параметров и выражений по индексам таблицы имён шаблона
+    QVector<Value> m_values;
+    //Скомпилированные функции JS выражений и шаблонов атрибутов вне подмножества
+    QVector<QJSValue> m_expressionFunctions;
+    QVector<QJSValue> m_bindingFunctions;
+    //Текущие значения атрибутов и текста
+    QVector<QString> m_bindingValues;
+    //Создаётся при первом выражении, которое нельзя вычислить без JS
+    QJSEngine *m_jsEngine;
+    QVector<bool> m_dirtyExpressions;
+    QVector<bool> m_dirtyBindings;
+    //Переиспользуемый буфер для SVG
+    QByteArray m_renderBuffer;
+    //Номера изменённых параметров в порядке изменения
+    QVector<int> m_changedParameters;
+    QVector<bool> m_isParameterChanged;
+    QString m_namespace;
+    ParametricSvgDiagnostics m_diagnostics;
+    //Статистика; отсутствует, если выключена
+    ParametricSvgStats *m_stats;
+    //Ограничения времени (мс); 0 - без ограничения
+    int m_evaluationBudget;
+    int m_updateBudget;
+    QDeadlineTimer m_updateDeadline;
+    //Последнее обновление прервано по времени
+    bool m_isOverrun;
+    bool m_isUpdateExpired;
+    //Пропущенные вычисления выполняются при следующем обновлении
+    bool m_isFullEvaluationRequired;
+    //Режим экземпляров: пути, которые рисуются без QSvgRenderer
+    bool m_isInstancingEnabled;
+    const ParametricSvgTemplate::Instancing *m_instancing;
+    QVector<ParametricSvgPath> m_nativePaths;
+    //Номер пути для каждой привязки или -1
+    QVector<int> m_nativePathIndices;
+    //Строки путей, вычисленных по числовым ячейкам, обновляются в toSvg()
+    QVector<bool> m_isBindingStale;
+    //Последнее обновление изменило значения в наложении
+    bool m_isOverlayChanged;
+
+
+    //методы
+    void setTemplate(const QSharedPointer<const ParametricSvgTemplate> &svgTemplate);
+    void resetJsEngine();
+    QJSEngine *jsEngine();
+    void compileFunctions();
+    void appendEscaped(QByteArray &buffer, const QString &value);
+    const QByteArray &assemble(const QVector<RenderSegment> &segments);
+    QJSValue callCompiled(QJSEngine *jsEngine, const QJSValue &function, const QString &source);
+    void setValue(int index, const Value &value);
+    void readJsValues();
+
+    void evaluateParameters();
+    void evaluateExpressions();
+
+    void evaluateXmlDocument();
+    bool evaluateBinding(int index);
+    void evaluateNativePath(int binding, int pathIndex);
+    void evaluateStaleBindings();
+    void updateNativePaths();
+    bool isTemplateString(const QString &value);
+
+    void evaluateDirty();
+    bool isUpdateExpired();
+
+    void expressionValuesToParameterValues(const QVector<int> &indices);
+    bool isNumberValueInRange(int handle, double value) const;
+    static bool isNumberType(const QVariant &value);
+    void markParameterChanged(int handle);
+    void storeParameter(int handle, const QVariant &value);
+
+    void addError(ParametricSvgDiagnostic::Site site, int index, const QString &source, const QString &message);
+
+    Q_DISABLE_COPY(ParametricSvgDocument)
+
+public:
+    explicit ParametricSvgDocument(const QString &namespaceName = "parametric");
+    ~ParametricSvgDocument();
+
+    bool setContent(const QString &fname);
+    bool reload();
+    void copyFrom(const ParametricSvgDocument &other);
+    QSharedPointer<const ParametricSvgTemplate> svgTemplate() const;
+    bool isNull() const;
+    QString namespaceName() const;
+
+    bool setParameter(const QString &pName, QVariant value);
+    int parameterHandle(const QString &pName) const;
+    bool setParameter(int handle, double value);
+    bool setParameter(int handle, const QVariant &value);
+    double parameterNumber(int handle) const;
+    QVariant parameterValue(int handle) const;
+    QString parameterName(int handle) const;
+    void resetParameters();
+    bool hasChanges() const;
+    QVariantMap takeChangedParameters();
+    void assignEvaluatedValues(const QVariantMap &values);
+    QByteArray saveParameters() const;
+    bool restoreParameters(const QByteArray &snapshot);
+
+    void evaluateAll();
+    void evaluateChanged();
+
+    const QByteArray &toSvg();
+    const QByteArray &toInstanceSvg();
+    QByteArray renderKey() const;
+
+    void setInstancingEnabled(bool isEnabled);
+    bool isInstancingEnabled() const;
+    bool isOverlayChanged() const;
+    QVector<QPainterPath> nativePaths();
+
+    QVariant::Type parameterType(const QString &pName) const;
+    QVariant parameterValue(const QString &pName) const;
+    QVariantMap parameterValues() const;
+    qreal parameterMin(const QString &pName) const;
+    qreal parameterMax(const QString &pName) const;
+    bool parameterIsExist(const QString &pName) const;
+    QStringList parameterNames() const;
+    int parametersCount() const;
+
+    void setEvaluationBudget(int msecs);
+    int evaluationBudget() const;
+    void setUpdateBudget(int msecs);
+    int updateBudget() const;
+    bool isOverrun() const;
+
+    bool isError() const;
+    QStringList errors() const;
+    ParametricSvgDiagnostics &diagnostics();
+    const ParametricSvgDiagnostics &diagnostics() const;
+
+    void setStatsEnabled(bool isEnabled);
+    bool isStatsEnabled() const;
+    ParametricSvgStats *stats();
+    void resetStats();
+};
+
+#endif // PARAMETRICSVGDOCUMENT_H
@@ -0,0 +1,27 @@
+# Evaluation of parametric SVG without graphics items
+
+# QJSEngine::setInterrupted() используется сторожем вычислений
+lessThan(QT_MAJOR_VERSION, 5): error("Qt 5.14 or later is required")
+equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 14): error("Qt 5.14 or later is required")
+
+QT += qml xml
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/parametricexpression.cpp \
+    $$PWD/parametricsvgdiagnostics.cpp \
+    $$PWD/parametricsvgdocument.cpp \
+    $$PWD/parametricsvgpath.cpp \
+    $$PWD/parametricsvgstats.cpp \
+    $$PWD/parametricsvgtemplate.cpp \
+    $$PWD/parametricsvgwatchdog.cpp
+
+HEADERS += \
+    $$PWD/parametricexpression.h \
+    $$PWD/parametricsvgdiagnostics.h \
+    $$PWD/parametricsvgdocument.h \
+    $$PWD/parametricsvgpath.h \
+    $$PWD/parametricsvgstats.h \
+    $$PWD/parametricsvgtemplate.h \
+    $$PWD/parametricsvgwatchdog.h
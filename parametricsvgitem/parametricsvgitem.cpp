@@ -3,11 +3,16 @@
  * Parametric SVG graphics item
  */
 #include "parametricsvgitem.h"
-#include <QFile>
-#include <QDomDocument>
-#include <QJSEngine>
-#include <QXmlStreamReader>
+#include "parametricsvganimationclock.h"
+#include "parametricsvgreloader.h"
+#include "parametricsvgrendercache.h"
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
 #include <QSvgRenderer>
+#include <QtConcurrent>
+#include <QtMath>
 
 ParametricSvgItem::ParametricSvgItem(const QString &fname, const QString namespaceName, QGraphicsItem *parent):
     ParametricSvgItem::ParametricSvgItem(parent, namespaceName)
@@ -16,24 +21,49 @@ ParametricSvgItem::ParametricSvgItem(const QString &fname, const QString namespa
 }
 
 ParametricSvgItem::ParametricSvgItem(QGraphicsItem *parent, const QString namespaceName):
-    QGraphicsSvgItem::QGraphicsSvgItem(parent)
+    QGraphicsSvgItem::QGraphicsSvgItem(parent),
+    m_document(namespaceName),
+    m_isRendererShared(false),
+    m_renderCacheMode(NoRenderCache),
+    m_updateMode(ImmediateUpdate),
+    m_updateLevel(0),
+    m_isUpdatePending(false),
+    m_isUpdateScheduled(false),
+    m_evaluationMode(SynchronousEvaluation),
+    m_evaluationWatcher(new QFutureWatcher<EvaluationResult>(this)),
+    m_generation(0),
+    m_lodMode(NoLod),
+    m_lodThreshold(16.0),
+    m_isLodDeferred(false),
+    m_rasterCacheMode(NoRasterCache),
+    m_contentVersion(0),
+    m_rasterWatcher(new QFutureWatcher<QImage>(this)),
+    m_isInstancingEnabled(false),
+    m_isRendererOutdated(true),
+    m_isHotReloadEnabled(false)
 {
     setFlags(
                 QGraphicsItem::ItemIsSelectable
                 //| QGraphicsItem::ItemIsMovable
                 | QGraphicsItem::ItemSendsGeometryChanges);
 
-    QSvgRenderer *renderer = new QSvgRenderer();
-    this->setSharedRenderer(renderer);
-
-    setNamespace(namespaceName);
+    m_renderer = QSharedPointer<QSvgRenderer>(new QSvgRenderer());
+    this->setSharedRenderer(m_renderer.data());
 
+    connect(m_evaluationWatcher, &QFutureWatcher<EvaluationResult>::finished,
+            this, &ParametricSvgItem::applyEvaluationResult);
+    connect(m_rasterWatcher, &QFutureWatcher<QImage>::finished,
+            this, &ParametricSvgItem::applyRasterImage);
 }
 
 ParametricSvgItem::~ParametricSvgItem()
 {
-    if(renderer())
-        delete renderer();
+    if(!m_transitions.isEmpty()){
+        ParametricSvgAnimationClock::instance()->stop(this);
+    }
+    if(m_isHotReloadEnabled){
+        ParametricSvgReloader::instance()->unwatch(this);
+    }
 }
 
 /*!
@@ -44,485 +74,1342 @@ ParametricSvgItem::~ParametricSvgItem()
   */
 bool ParametricSvgItem::setContent(const QString &fname)
 {
-
-    bool isOk = readXmlFromFile(fname);
-    if(!isOk){
+    m_document.resetStats();
+    if(!m_document.setContent(fname)){
         return false;
     }
+    if(m_isHotReloadEnabled){
+        ParametricSvgReloader::instance()->watch(this);
+    }
+    showContent();
+    return true;
+}
 
-    QDomElement docElem = m_xmlDoc.documentElement();
-    if(docElem.isNull()){
+/*!
+  * Load the template again after its file was changed, keeping parameter
+  * values set by the item, which are compatible with the new template
+  *
+  * \return false, if the file is not changed or can not be loaded
+  */
+bool ParametricSvgItem::reload()
+{
+    m_document.resetStats();
+    if(!m_document.reload()){
         return false;
     }
+    showContent();
+    return true;
+}
 
-    QDomNode defsNode = docElem.firstChildElement("defs");
+/*!
+  * Show new content of the document evaluated in full
+  */
+void ParametricSvgItem::showContent()
+{
+    //Результаты вычислений для прежнего содержимого не нужны
+    ++m_generation;
+    stopTransitions();
+    m_asyncDocument.clear();
+    m_asyncChanges.clear();
+
+    //Полный пересчёт включает все отложенные изменения
+    m_isUpdatePending = false;
+    m_isLodDeferred = false;
+    updateStaticRenderer();
+    redraw();
+    publishStats();
+    publishDiagnostics();
+}
 
-    isOk = readParameters(defsNode);
-    if(!isOk){
-        return false;
+QSharedPointer<const ParametricSvgTemplate> ParametricSvgItem::svgTemplate() const
+{
+    return m_document.svgTemplate();
+}
+
+/*!
+  * Reload the item, when the file of its template is changed.
+  * Files are watched by ParametricSvgReloader.
+  *
+  * \param[in] isEnabled true to watch the file
+  */
+void ParametricSvgItem::setHotReloadEnabled(bool isEnabled)
+{
+    if(m_isHotReloadEnabled == isEnabled){
+        return;
     }
+    m_isHotReloadEnabled = isEnabled;
+    if(isEnabled){
+        ParametricSvgReloader::instance()->watch(this);
+    }else{
+        ParametricSvgReloader::instance()->unwatch(this);
+    }
+}
 
-    //Выражения JS
-    isOk = readExpressions(defsNode);
-    if(!isOk){
-        return false;
+bool ParametricSvgItem::isHotReloadEnabled() const
+{
+    return m_isHotReloadEnabled;
+}
+
+/*!
+  * Create a copy of the item with the same template, parameters and settings
+  * without reading the file and evaluation. The copy shares the template
+  * and the current renderer with the item until one of them is changed.
+  * Position, transformation and active transitions are not copied.
+  *
+  * \param[in] parent parent of the copy
+  * \return new item
+  */
+ParametricSvgItem *ParametricSvgItem::clone(QGraphicsItem *parent) const
+{
+    ParametricSvgItem *item = new ParametricSvgItem(parent, m_document.namespaceName());
+    item->m_renderCacheMode = m_renderCacheMode;
+    item->m_updateMode = m_updateMode;
+    item->m_evaluationMode = m_evaluationMode;
+    item->m_lodMode = m_lodMode;
+    item->m_lodThreshold = m_lodThreshold;
+    item->m_rasterCacheMode = m_rasterCacheMode;
+    item->m_isInstancingEnabled = m_isInstancingEnabled;
+    item->m_document.copyFrom(m_document);
+    item->setHotReloadEnabled(m_isHotReloadEnabled);
+    if(m_document.isNull()){
+        return item;
     }
 
-    evaluateAll();
-    redraw();
-    return true;
+    //Рендерер заменяется новым при следующем изменении любого из элементов
+    m_isRendererShared = true;
+    item->m_isRendererShared = true;
+    item->m_renderKey = m_renderKey;
+    item->m_staticRenderer = m_staticRenderer;
+    item->m_nativePaths = m_nativePaths;
+    item->useRenderer(m_renderer);
+    item->m_isRendererOutdated = m_isRendererOutdated;
+    item->m_rasterData = m_rasterData;
+    if(m_rasterKey.version == m_contentVersion){
+        item->m_rasterImage = m_rasterImage;
+        item->m_rasterKey = m_rasterKey;
+        item->m_rasterKey.version = item->m_contentVersion;
+    }
+
+    //Изменения, которые ещё не показаны элементом
+    bool isPending = m_isUpdatePending || m_isLodDeferred || m_document.hasChanges();
+    if(m_evaluationMode == AsynchronousEvaluation){
+        //Копия документа для рабочих потоков создаётся со всеми значениями
+        isPending = isPending || isEvaluating() || !m_asyncChanges.isEmpty();
+    }
+    if(isPending){
+        item->m_isUpdatePending = true;
+        item->flushUpdate();
+    }
+    return item;
 }
 
 /*!
   * Update graphics from SVG data
+  *
+  * With the render cache enabled, items with the same template and
+  * parameter values share one renderer and SVG is loaded only once.
   */
 void ParametricSvgItem::redraw()
 {
     prepareGeometryChange();
-    QXmlStreamReader xmlreader(m_xmlDoc.toString());
-    this->renderer()->load(&xmlreader);
-    this->setElementId("");
+
+    ParametricSvgStats *stats = m_document.stats();
+    qint64 *loadTime = stats ? &stats->loadTime : nullptr;
+
+    QSharedPointer<QSvgRenderer> renderer;
+    if(m_renderCacheMode != NoRenderCache){
+        m_renderKey = currentRenderKey();
+        renderer = ParametricSvgRenderCache::instance()->renderer(m_renderKey);
+        if(renderer.isNull()){
+            const QByteArray &data = svgData();
+            ParametricSvgPhase phase(loadTime, "loadRenderer");
+            renderer = ParametricSvgRenderCache::instance()->insert(m_renderKey, data);
+        }
+        m_isRendererShared = true;
+    }else{
+        m_renderKey.clear();
+        //Общий рендерер из кэша изменять нельзя
+        if(m_isRendererShared){
+            renderer = QSharedPointer<QSvgRenderer>(new QSvgRenderer());
+            m_isRendererShared = false;
+        }else{
+            renderer = m_renderer;
+        }
+        const QByteArray &data = svgData();
+        ParametricSvgPhase phase(loadTime, "loadRenderer");
+        renderer->load(data);
+    }
+
+    m_nativePaths = isInstanced() ? m_document.nativePaths() : QVector<QPainterPath>();
+    useRenderer(renderer);
 }
 
 /*!
-  * Load content from SVG file
+  * Show graphics of the renderer
   *
-  * \param[in] fname Full path to SVG file
-  * \return true on succes
+  * \param[in] renderer loaded renderer
   */
-bool ParametricSvgItem::readXmlFromFile(const QString &fname)
+void ParametricSvgItem::useRenderer(const QSharedPointer<QSvgRenderer> &renderer)
 {
-    if(fname.isEmpty()){
-        return false;
+    if(renderer != m_renderer){
+        this->setSharedRenderer(renderer.data());
+        m_renderer = renderer;
     }
+    this->setElementId("");
+    m_isRendererOutdated = false;
+    m_lodPixmap = QPixmap();
+    //Растровое изображение остаётся до отрисовки новой графики
+    ++m_contentVersion;
+    m_rasterData.clear();
+}
 
-    QFile file(fname);
-    if (!file.open(QIODevice::ReadOnly))
-        return false;
+/*!
+  * Start evaluation of pending changes in a worker thread.
+  * The current graphics stay visible until the result is ready.
+  */
+void ParametricSvgItem::startEvaluation()
+{
+    //Копия документа создаётся с полным набором значений параметров
+    if(m_asyncDocument.isNull()){
+        m_asyncDocument = QSharedPointer<ParametricSvgDocument>(new ParametricSvgDocument(m_document.namespaceName()));
+        m_asyncChanges = m_document.parameterValues();
+    }
+
+    QSharedPointer<ParametricSvgDocument> document = m_asyncDocument;
+    const QString fname = m_document.svgTemplate()->fileName();
+    const QVariantMap changes = m_asyncChanges;
+    const int generation = m_generation;
+    const QByteArray key = m_renderCacheMode != NoRenderCache ? currentRenderKey() : QByteArray();
+    const bool isOverlay = isInstanced();
+    const bool isRendererRequired = m_isRendererOutdated;
+    const bool isStatsEnabled = m_document.isStatsEnabled();
+    const bool isSvgDataRequired = m_rasterCacheMode == BackgroundRasterCache;
+    const int evaluationBudget = m_document.evaluationBudget();
+    const int updateBudget = m_document.updateBudget();
+    QThread *itemThread = thread();
+    m_asyncChanges.clear();
+
+    m_evaluationWatcher->setFuture(QtConcurrent::run([=]() {
+        EvaluationResult result;
+        result.generation = generation;
+        result.renderKey = key;
+        document->setStatsEnabled(isStatsEnabled);
+        document->resetStats();
+        document->setEvaluationBudget(evaluationBudget);
+        document->setUpdateBudget(updateBudget);
+        document->setInstancingEnabled(isOverlay);
+
+        if(document->isNull() && !document->setContent(fname)){
+            ParametricSvgDiagnostic diagnostic;
+            diagnostic.message = QString("Can not load %1").arg(fname);
+            result.diagnostics.append(diagnostic);
+            return result;
+        }
+        QVariantMap::const_iterator i = changes.constBegin();
+        for (; i != changes.constEnd(); ++i) {
+            document->setParameter(i.key(), i.value());
+        }
+        document->evaluateChanged();
+
+        result.parameters = document->parameterValues();
+        result.diagnostics = document->diagnostics().current();
+        if(document->isOverrun()){
+            return result;
+        }
+        if(isOverlay){
+            result.nativePaths = document->nativePaths();
+        }
+
+        //Если изменились только пути, элемент оставляет прежний рендерер
+        if(!isOverlay || isRendererRequired || document->isOverlayChanged()){
+            //SVG разбирается в рабочем потоке, рендерер передаётся потоку элемента
+            const QByteArray &data = isOverlay ? document->toInstanceSvg() : document->toSvg();
+            result.dataSize = data.size();
+            if(isSvgDataRequired){
+                result.svgData = QByteArray(data.constData(), data.size());
+            }
+            {
+                ParametricSvgPhase phase(document->stats() ? &document->stats()->loadTime : nullptr, "loadRenderer");
+                result.renderer = QSharedPointer<QSvgRenderer>(new QSvgRenderer(data));
+            }
+            result.renderer->moveToThread(itemThread);
+        }
+
+        if(document->stats()){
+            result.stats = *document->stats();
+            result.hasStats = true;
+        }
+        return result;
+    }));
+}
+
+/*!
+  * Show the result of evaluation in a worker thread and start
+  * the next evaluation, if parameters were changed meanwhile
+  */
+void ParametricSvgItem::applyEvaluationResult()
+{
+    EvaluationResult result = m_evaluationWatcher->result();
+    if(result.generation == m_generation){
+        m_document.assignEvaluatedValues(result.parameters);
+        m_document.diagnostics().merge(result.diagnostics);
+        publishDiagnostics();
+        if(isInstanced() && !result.nativePaths.isEmpty()){
+            m_nativePaths = result.nativePaths;
+            m_lodPixmap = QPixmap();
+            update();
+        }
 
-    if (!m_xmlDoc.setContent(&file)) {
-        file.close();
+        //При ошибке остаётся последнее корректное изображение
+        if(!result.renderer.isNull() && result.renderer->isValid()){
+            prepareGeometryChange();
+            if(m_renderCacheMode != NoRenderCache){
+                ParametricSvgRenderCache::instance()->insert(result.renderKey, result.renderer, result.dataSize);
+                m_renderKey = result.renderKey;
+                m_isRendererShared = true;
+            }else{
+                m_renderKey.clear();
+                m_isRendererShared = false;
+            }
+            useRenderer(result.renderer);
+            m_rasterData = result.svgData;
+        }
+
+        if(result.hasStats){
+            m_stats = result.stats;
+            emit statsUpdated(m_stats);
+        }
+    }
+
+    if(m_isUpdatePending){
+        requestUpdate();
+    }
+}
+
+/*!
+  * Show renderer from the render cache for the current parameter values
+  *
+  * \return false, if the cache is disabled or there is no such entry
+  */
+bool ParametricSvgItem::useCachedRenderer()
+{
+    //Пути из кэша рендереров не восстанавливаются
+    if(m_renderCacheMode == NoRenderCache || hasNativePaths()){
+        return false;
+    }
+    const QByteArray key = currentRenderKey();
+    QSharedPointer<QSvgRenderer> renderer = ParametricSvgRenderCache::instance()->renderer(key);
+    if(renderer.isNull()){
         return false;
     }
-    file.close();
+
+    prepareGeometryChange();
+    m_renderKey = key;
+    m_isRendererShared = true;
+    useRenderer(renderer);
     return true;
 }
 
 /*!
-  * Read parameters from SVG and create it
+  * Paint the item. With the raster cache or RendererAndPixmapCache mode
+  * the rasterized image is used instead of rendering SVG again.
+  */
+void ParametricSvgItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    if(m_lodMode != NoLod){
+        const QRectF bounds = boundingRect();
+        const qreal size = qMax(bounds.width(), bounds.height())
+                * QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+        if(size < m_lodThreshold){
+            paintLod(painter, option);
+            return;
+        }
+        //Элемент стал видимым: отложенные изменения вычисляются вне отрисовки
+        if(m_isLodDeferred){
+            QMetaObject::invokeMethod(this, "updateDeferred", Qt::QueuedConnection);
+        }
+    }
+
+    //Параметрические элементы рисуются поверх общей статической части
+    if(isInstanced()){
+        m_staticRenderer->render(painter, boundingRect());
+        paintNativePaths(painter, boundingRect());
+    }
+
+    if(m_rasterCacheMode != NoRasterCache && paintRaster(painter, option)){
+        return;
+    }
+
+    if(m_renderCacheMode != RendererAndPixmapCache || m_renderKey.isEmpty()){
+        QGraphicsSvgItem::paint(painter, option, widget);
+        return;
+    }
+
+    const QRectF bounds = boundingRect();
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform())
+            * painter->device()->devicePixelRatioF();
+    QPixmap pixmap = ParametricSvgRenderCache::instance()->pixmap(m_renderKey, (bounds.size() * scale).toSize());
+    if(pixmap.isNull()){
+        QGraphicsSvgItem::paint(painter, option, widget);
+        return;
+    }
+
+    painter->drawPixmap(bounds, pixmap, QRectF(pixmap.rect()));
+    paintSelection(painter, option);
+}
+
+/*!
+  * Paint the item from its raster image. The image is rendered again
+  * only after the graphics change or when the scale moves to another
+  * step of sqrt(2). In BackgroundRasterCache mode the new image is rendered
+  * in a worker thread and the previous one is painted meanwhile.
   *
-  * \param[in] node XML node with parameters declaration
-  * \return true on succes
+  * \return false, if the item must be painted as SVG
   */
-bool ParametricSvgItem::readParameters(const QDomNode &node)
+bool ParametricSvgItem::paintRaster(QPainter *painter, const QStyleOptionGraphicsItem *option)
 {
-    if(node.isNull()){
+    //Предел размера изображения; при большем увеличении SVG отрисовывается напрямую
+    static const int maxSide = 4096;
+
+    const QRectF bounds = boundingRect();
+    if(bounds.isEmpty() || !m_renderer || !m_renderer->isValid()){
         return false;
     }
 
-    QDomNodeList list = node.toElement().elementsByTagName(getNamespace() + ":default");
-    for(int i=0; i<list.size(); ++i){
-        Parameter param = domNodeToParameter(list.at(i));
+    RasterKey key;
+    key.version = m_contentVersion;
+    key.scale = rasterScale(QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform()));
+    key.devicePixelRatio = painter->device()->devicePixelRatioF();
+    const QSize size = (bounds.size() * key.scale * key.devicePixelRatio).toSize().expandedTo(QSize(1, 1));
+    if(size.width() > maxSide || size.height() > maxSide){
+        return false;
+    }
 
-        if (!param.name.isEmpty()) {
-            addParameter(param.name, param);
+    if(!(m_rasterKey == key)){
+        if(m_rasterCacheMode == BackgroundRasterCache
+                && m_evaluationMode == SynchronousEvaluation && m_rasterData.isEmpty()){
+            const QByteArray &data = svgData();
+            m_rasterData = QByteArray(data.constData(), data.size());
+        }
+        if(m_rasterCacheMode == BackgroundRasterCache && !m_rasterData.isEmpty()){
+            startRasterization(key, size);
+            if(m_rasterImage.isNull()){
+                return false;
+            }
+        }else{
+            m_rasterImage = rasterize(m_renderer.data(), size);
+            m_rasterKey = key;
         }
     }
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawImage(bounds, m_rasterImage, QRectF(m_rasterImage.rect()));
+    painter->restore();
+    paintSelection(painter, option);
     return true;
 }
 
 /*!
-  * Add variable parameter to parameters list
+  * Start rendering of raster image in a worker thread. A running job
+  * is not interrupted; the image is requested again after it finishes.
   *
-  * \param[in] pName parameter name
-  * \param[in] param parameter data
+  * \param[in] key graphics and scale of the image
+  * \param[in] size size of the image in device pixels
   */
-void ParametricSvgItem::addParameter(const QString &pName, const Parameter &param)
+void ParametricSvgItem::startRasterization(const RasterKey &key, const QSize &size)
 {
-    if(pName.isEmpty()){
+    if(m_rasterWatcher->isRunning()){
         return;
     }
-    if(!param.value.isValid() || param.value.isNull()){
-        return;
+    m_rasterJobKey = key;
+    const QByteArray data = m_rasterData;
+    m_rasterWatcher->setFuture(QtConcurrent::run([=]() {
+        //QSvgRenderer нельзя использовать из двух потоков
+        QSvgRenderer renderer(data);
+        return rasterize(&renderer, size);
+    }));
+}
+
+/*!
+  * Use raster image rendered in a worker thread
+  */
+void ParametricSvgItem::applyRasterImage()
+{
+    QImage image = m_rasterWatcher->result();
+    if(!image.isNull() && m_rasterJobKey.version == m_contentVersion){
+        m_rasterImage = image;
+        m_rasterKey = m_rasterJobKey;
     }
-    m_parameters[pName] = param;
+    //Отрисовка запросит изображение для текущего масштаба, если он изменился
+    update();
 }
 
 /*!
-  * Convert XML QDomNode to Parameter
+  * Round scale up to a step of sqrt(2), so that small zoom changes
+  * reuse the image without visible loss of quality
   *
-  * \param[in] node XML node
-  * \return Parameter. An empty Parameter on error
+  * \param[in] scale scale of the painter
+  * \return scale of raster image
   */
-ParametricSvgItem::Parameter ParametricSvgItem::domNodeToParameter(const QDomNode &node)
+qreal ParametricSvgItem::rasterScale(qreal scale)
 {
-    Parameter result;
-    bool ok;
-
-    if(node.isNull() || !node.isElement()){
-        return Parameter();
+    if(scale <= 0.0){
+        return 1.0;
     }
+    return qPow(2.0, qCeil(std::log2(scale) * 2.0 - 1e-6) / 2.0);
+}
 
-    //Name
-    QString nameParam = node.toElement().attribute("param");
-    if(nameParam.isEmpty()){
-        return Parameter();
-    }
-    result.name = nameParam;
+/*!
+  * Render SVG into image
+  *
+  * \param[in] renderer loaded renderer
+  * \param[in] size size of the image
+  * \return image with transparent background
+  */
+QImage ParametricSvgItem::rasterize(QSvgRenderer *renderer, const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    renderer->render(&painter, QRectF(image.rect()));
+    painter.end();
+    return image;
+}
 
-    //Value
-    QString valueParam = node.toElement().attribute("value");
-    if(valueParam.isEmpty()){
-        return Parameter();
+/*!
+  * Enable instancing. The part of the template, which does not depend
+  * on parameters, is loaded once into a renderer shared by all items
+  * with the template, and each item loads only its parametric elements.
+  * Parametric elements are painted over the whole static part.
+  * Paths, whose only parametric attribute is `d`, are drawn as QPainterPath
+  * between the static part and the other parametric elements, and changes
+  * of such paths alone do not load SVG again.
+  * Templates with parametric definitions or styles are drawn as usual.
+  *
+  * \param[in] isEnabled true to share the static part
+  */
+void ParametricSvgItem::setInstancingEnabled(bool isEnabled)
+{
+    if(m_isInstancingEnabled == isEnabled){
+        return;
     }
-    double value = valueParam.toDouble(&ok);
-    if(ok){
-        result.value = QVariant(value);
-    }else{
-        result.value = QVariant(valueParam);
+    m_isInstancingEnabled = isEnabled;
+    m_document.setInstancingEnabled(isEnabled);
+    if(m_document.isNull()){
+        return;
+    }
+    updateStaticRenderer();
+    m_isRendererOutdated = true;
+    if(m_evaluationMode == AsynchronousEvaluation){
+        //Копия документа создаётся заново в новом режиме
+        ++m_generation;
+        m_asyncDocument.clear();
+        m_isUpdatePending = true;
+        flushUpdate();
+        return;
     }
+    redraw();
+}
 
-    //Min limit
-    QString minParam = node.toElement().attribute("min");
+bool ParametricSvgItem::isInstancingEnabled() const
+{
+    return m_isInstancingEnabled;
+}
 
-    double min = minParam.toDouble(&ok);
-    if(ok){
-        result.min = min;
-    }else{
-        result.min = -99999.0;
+/*!
+  * Find or load the shared renderer of the static part of the template
+  */
+void ParametricSvgItem::updateStaticRenderer()
+{
+    m_staticRenderer.clear();
+    if(!m_isInstancingEnabled || m_document.isNull()){
+        return;
+    }
+    QSharedPointer<const ParametricSvgTemplate> svgTemplate = m_document.svgTemplate();
+    const ParametricSvgTemplate::Instancing &instancing = svgTemplate->instancing();
+    if(!instancing.isValid){
+        return;
     }
 
-    //Max limit
-    QString maxParam = node.toElement().attribute("max");
-    double max = maxParam.toDouble(&ok);
-    if(ok){
-        result.max = max;
-    }else{
-        result.max = 99999.0;
+    //Запись кэша вытесняется независимо от элементов, которые её используют
+    const QByteArray key = "static:" + QByteArray::number(svgTemplate->id());
+    m_staticRenderer = ParametricSvgRenderCache::instance()->renderer(key);
+    if(m_staticRenderer.isNull()){
+        m_staticRenderer = ParametricSvgRenderCache::instance()->insert(key, instancing.staticSvg);
     }
+}
 
-    return result;
+bool ParametricSvgItem::isInstanced() const
+{
+    return !m_staticRenderer.isNull();
+}
+
+bool ParametricSvgItem::hasNativePaths() const
+{
+    return isInstanced() && !m_document.svgTemplate()->instancing().nativePaths.isEmpty();
 }
 
 /*!
-  * Read expressions from SVG and add it to expression list
+  * Paint paths, which are drawn without QSvgRenderer
   *
-  * \param[in] node XML node with parameters declaration
-  * \return true on succes
+  * \param[in] painter painter
+  * \param[in] bounds rectangle, to which the view box of SVG is mapped
   */
-bool ParametricSvgItem::readExpressions(const QDomNode &node)
+void ParametricSvgItem::paintNativePaths(QPainter *painter, const QRectF &bounds)
 {
-    if(node.isNull()){
-        return false;
+    const QVector<ParametricSvgTemplate::NativePath> &styles = m_document.svgTemplate()->instancing().nativePaths;
+    const QRectF viewBox = m_staticRenderer->viewBoxF();
+    if(m_nativePaths.size() != styles.size() || viewBox.isEmpty()){
+        return;
     }
 
-    QDomNodeList exps = node.toElement().elementsByTagName(getNamespace() + ":expression");
-    if(!exps.isEmpty()){
-        m_expressions.clear();
-    }
-    for(int i=0; i<exps.size(); ++i){
-        Expression exp = domNodeToExpression(exps.at(i));
-        addExpression(exp);
+    //Так же, как QSvgRenderer, область просмотра растягивается на весь прямоугольник
+    const QTransform viewTransform = QTransform::fromTranslate(-viewBox.x(), -viewBox.y())
+            * QTransform::fromScale(bounds.width() / viewBox.width(), bounds.height() / viewBox.height())
+            * QTransform::fromTranslate(bounds.x(), bounds.y());
+    for (int i = 0; i < m_nativePaths.size(); ++i) {
+        const ParametricSvgTemplate::NativePath &style = styles.at(i);
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setWorldTransform(style.transform * viewTransform, true);
+        painter->setOpacity(painter->opacity() * style.opacity);
+        painter->setPen(style.pen);
+        painter->setBrush(style.brush);
+        painter->drawPath(m_nativePaths.at(i));
+        painter->restore();
     }
+}
 
-    return true;
+/*!
+  * Get evaluated SVG of the item: the whole document or the parametric overlay
+  *
+  * \return SVG data. It is valid until the next evaluation
+  */
+const QByteArray &ParametricSvgItem::svgData()
+{
+    return isInstanced() ? m_document.toInstanceSvg() : m_document.toSvg();
+}
+
+/*!
+  * Build key of the render cache for the evaluated SVG of the item
+  *
+  * \return cache key
+  */
+QByteArray ParametricSvgItem::currentRenderKey() const
+{
+    //Наложение и полный документ с теми же параметрами различаются
+    return isInstanced() ? "overlay:" + m_document.renderKey() : m_document.renderKey();
 }
 
 /*!
-  * Convert XML QDomNode to Expression
+  * Set usage of the raster image of the item
   *
-  * \param[in] node XML node
-  * \return Expression. An empty Expression on error
+  * \param[in] mode raster cache mode
   */
-ParametricSvgItem::Expression ParametricSvgItem::domNodeToExpression(const QDomNode &node)
+void ParametricSvgItem::setRasterCacheMode(ParametricSvgItem::RasterCacheMode mode)
 {
-    if(node.isNull() || !node.isElement()){
-        return Expression();
+    if(m_rasterCacheMode == mode){
+        return;
     }
+    m_rasterCacheMode = mode;
+    m_rasterImage = QImage();
+    m_rasterKey = RasterKey();
+    update();
+}
+
+ParametricSvgItem::RasterCacheMode ParametricSvgItem::rasterCacheMode() const
+{
+    return m_rasterCacheMode;
+}
 
-    //Name
-    QString variableName = node.toElement().attribute("var");
-    if(variableName.isEmpty()){
-        return Expression();
+/*!
+  * Paint frame of the selected item
+  */
+void ParametricSvgItem::paintSelection(QPainter *painter, const QStyleOptionGraphicsItem *option)
+{
+    if(option->state & QStyle::State_Selected){
+        painter->setPen(QPen(option->palette.windowText(), 0, Qt::DashLine));
+        painter->setBrush(Qt::NoBrush);
+        painter->drawRect(boundingRect());
     }
+}
 
-    //Value
-    QString variableValue = node.toElement().attribute("exp");
-    if(variableValue.isEmpty()){
-        //If the 'exp' attribute is empty,
-        //then the value is read from the node text (CDATA is acceptable).
-        variableValue = node.toElement().text();
-        if(variableValue.isEmpty()){
-            return Expression();
-        }
+/*!
+  * Set usage of the shared render cache
+  *
+  * \param[in] mode cache mode
+  */
+void ParametricSvgItem::setRenderCacheMode(ParametricSvgItem::RenderCacheMode mode)
+{
+    if(m_renderCacheMode == mode){
+        return;
     }
-    Expression exp;
-    exp.name = variableName;
-    exp.value = variableValue;
+    m_renderCacheMode = mode;
+    if(m_document.isNull()){
+        return;
+    }
+    if(m_evaluationMode == AsynchronousEvaluation){
+        //Документ элемента не пересчитывается в этом режиме
+        m_isUpdatePending = true;
+        flushUpdate();
+        return;
+    }
+    redraw();
+}
 
-    return exp;
+ParametricSvgItem::RenderCacheMode ParametricSvgItem::renderCacheMode() const
+{
+    return m_renderCacheMode;
 }
 
 /*!
-  * Add Expression to list
+  * Slot for changing parameter by qreal value
   *
-  * \param[in] exp Expresion
+  * \param[in] pName parameter name
+  * \param[in] d value
   */
-void ParametricSvgItem::addExpression(const ParametricSvgItem::Expression &exp)
+void ParametricSvgItem::changeParamByName(const QString &pName, qreal d)
 {
-    if(exp.name.isEmpty())
+    if(pName.isEmpty()){
         return;
-    m_expressions.append(exp);
+    }
+    updateByParameter(pName, QVariant(d));
+}
+
+int ParametricSvgItem::type() const
+{
+    return Type;
 }
 
 /*!
-  * Evaluate parameters, expressions and string templates in SVG document
+  * Set parameter value
+  *
+  * \param[in] pName paramter name
+  * \param[in] value parameter value
+  * \return true in success
   */
-void ParametricSvgItem::evaluateAll()
+bool ParametricSvgItem::setParameter(const QString &pName, QVariant value)
 {
-    QJSEngine jsEngine;
-    evaluateParameters(&jsEngine);
-    evaluateExpressions(&jsEngine);
-    evaluateXmlDocument(&jsEngine);
+    return m_document.setParameter(pName, value);
 }
 
 /*!
-  * Evaluate parameters and create equivalent variables in the JavaScript space
+  * Set parameter value, evaluate and update graphics, using calculated values
   *
-  * \param[in] jsEngine link to JavaScript Engine
+  * \param[in] pName parameter name
+  * \param[in] value parameter value
+  * \return true in success
   */
-void ParametricSvgItem::evaluateParameters(QJSEngine *jsEngine)
+bool ParametricSvgItem::updateByParameter(const QString &pName, QVariant value)
 {
-    QJSValue globalObj = jsEngine->globalObject();
+    bool isParamWasSet = setParameter(pName, value);
+    if(!isParamWasSet){
+        return false;
+    }
 
-    QMutableMapIterator<QString, Parameter> i(m_parameters);
-    while (i.hasNext()) {
-        i.next();                
+    requestUpdate();
 
-        QString valueS;
+    return true;
+}
 
-        if (i.value().value.type() == QVariant::String){
-            valueS = QString("`%1`").arg(i.value().value.toString());
-        } else {
-            valueS = i.value().value.toString();
-        }
+/*!
+  * Get handle of parameter for setParameter() and updateByParameter()
+  * without name lookups. Handles are valid until the next setContent().
+  *
+  * \param[in] pName parameter name
+  * \return handle. -1, if the parameter does not exist
+  */
+int ParametricSvgItem::parameterHandle(const QString &pName) const
+{
+    return m_document.parameterHandle(pName);
+}
 
-        QJSValue jsValue = jsEngine->evaluate(valueS);
-        if(!jsValue.isError()){
-            globalObj.setProperty(i.key(), jsValue);
-        }
-        addError(jsValue.isError(), jsValue.property("message").toString());
+/*!
+  * Set number value of parameter by handle
+  *
+  * \param[in] handle parameter handle
+  * \param[in] value parameter value
+  * \return true in success
+  */
+bool ParametricSvgItem::setParameter(int handle, double value)
+{
+    return m_document.setParameter(handle, value);
+}
+
+/*!
+  * Set number value of parameter by handle, evaluate and update graphics
+  *
+  * \param[in] handle parameter handle
+  * \param[in] value parameter value
+  * \return true in success
+  */
+bool ParametricSvgItem::updateByParameter(int handle, double value)
+{
+    if(!setParameter(handle, value)){
+        return false;
     }
+
+    requestUpdate();
+
+    return true;
 }
 
 /*!
-  * Evaluate expression and create equivalent variables in the JavaScript space
+  * Get number value of parameter by handle
   *
-  * \param[in] jsEngine link to JavaScript Engine
+  * \param[in] handle parameter handle
+  * \return value. 0, if the parameter is not a number
   */
-void ParametricSvgItem::evaluateExpressions(QJSEngine *jsEngine)
+double ParametricSvgItem::parameterNumber(int handle) const
 {
-    QJSValue globalObj = jsEngine->globalObject();
-    for (int i = 0; i < m_expressions.size(); ++i) {
-        QJSValue jsValue = jsEngine->evaluate(m_expressions.at(i).value);
+    return m_document.parameterNumber(handle);
+}
 
-        if(!jsValue.isError()){
-            globalObj.setProperty(m_expressions.at(i).name, jsValue);
+/*!
+  * Change number parameter smoothly. Transitions of all items are advanced
+  * by ParametricSvgAnimationClock, and each item is evaluated once per frame.
+  * The value is kept in the limits of the parameter.
+  *
+  * \param[in] pName parameter name
+  * \param[in] value final value
+  * \param[in] msecs duration in milliseconds
+  * \param[in] easing easing curve
+  * \return true, if the parameter is a number
+  */
+bool ParametricSvgItem::animateParameter(const QString &pName, double value, int msecs, const QEasingCurve &easing)
+{
+    return animateParameter(parameterHandle(pName), value, msecs, easing);
+}
+
+/*!
+  * Change number parameter smoothly
+  *
+  * \param[in] handle parameter handle
+  * \param[in] value final value
+  * \param[in] msecs duration in milliseconds
+  * \param[in] easing easing curve
+  * \return true, if the parameter is a number
+  */
+bool ParametricSvgItem::animateParameter(int handle, double value, int msecs, const QEasingCurve &easing)
+{
+    const QString pName = m_document.parameterName(handle);
+    if(pName.isEmpty() || m_document.parameterType(pName) != QVariant::Double){
+        return false;
+    }
+
+    Transition transition;
+    transition.handle = handle;
+    transition.min = m_document.parameterMin(pName);
+    transition.max = m_document.parameterMax(pName);
+    transition.from = m_document.parameterNumber(handle);
+    transition.to = qBound(transition.min, value, transition.max);
+    transition.start = ParametricSvgAnimationClock::instance()->elapsed();
+    transition.duration = msecs;
+    transition.easing = easing;
+
+    //Новый переход заменяет текущий и начинается с текущего значения
+    for (int i = 0; i < m_transitions.size(); ++i) {
+        if(m_transitions.at(i).handle == handle){
+            m_transitions.remove(i);
+            break;
         }
-        addError(jsValue.isError(), jsValue.property("message").toString());
-    }//for
+    }
 
-    //Обновить значения параметров, если они вычислялись в выражениях
-    expressionValuesToParameterValues(jsEngine);
+    if(msecs <= 0){
+        return updateByParameter(handle, transition.to);
+    }
+    m_transitions.append(transition);
+    ParametricSvgAnimationClock::instance()->start(this);
+    return true;
 }
 
-void ParametricSvgItem::expressionValuesToParameterValues(QJSEngine *jsEngine)
+/*!
+  * Stop all transitions. Parameters keep their current values.
+  */
+void ParametricSvgItem::stopTransitions()
 {
-    QJSValue globalObj = jsEngine->globalObject();
+    if(m_transitions.isEmpty()){
+        return;
+    }
+    m_transitions.clear();
+    ParametricSvgAnimationClock::instance()->stop(this);
+}
+
+bool ParametricSvgItem::isAnimating() const
+{
+    return !m_transitions.isEmpty();
+}
 
-    QMutableMapIterator<QString, Parameter> i(m_parameters);
-    while (i.hasNext()) {
-        i.next();
+/*!
+  * Set values of all transitions at the time of the clock and update graphics once
+  *
+  * \param[in] time time of ParametricSvgAnimationClock in milliseconds
+  * \return true, if there are unfinished transitions
+  */
+bool ParametricSvgItem::advanceTransitions(qint64 time)
+{
+    if(m_transitions.isEmpty()){
+        return false;
+    }
 
-        if(globalObj.hasProperty(i.key())){
-            QJSValue value = globalObj.property(i.key());
-            QVariant variantValue = value.toVariant();
-            if(variantValue.isValid() && i.value().value != variantValue)
-                setParameter(i.key(), variantValue);
+    beginUpdate();
+    for (int i = m_transitions.size() - 1; i >= 0; --i) {
+        const Transition &transition = m_transitions.at(i);
+        const qreal progress = qBound<qreal>(0.0, qreal(time - transition.start) / transition.duration, 1.0);
+        //Кривые с выходом за пределы не выводят значение из ограничений параметра
+        const double value = qBound(transition.min,
+                                    transition.from + (transition.to - transition.from) * transition.easing.valueForProgress(progress),
+                                    transition.max);
+        updateByParameter(transition.handle, value);
+        if(progress >= 1.0){
+            m_transitions.remove(i);
         }
-    }//while
+    }
+    endUpdate();
+
+    if(m_transitions.isEmpty()){
+        emit transitionsFinished();
+    }
+    //Получатель сигнала мог начать новые переходы
+    return !m_transitions.isEmpty();
 }
 
 /*!
-  * Evaluate tamplates string in SVG document
+  * Save values of all parameters into a compact versioned binary snapshot,
+  * e.g. for undo or copying of items
   *
-  * \param[in] jsEngine link to JavaScript Engine
+  * \return snapshot for restoreParameters()
   */
-void ParametricSvgItem::evaluateXmlDocument(QJSEngine *jsEngine)
+QByteArray ParametricSvgItem::saveParameters() const
 {
-    traverseXmlNode(m_xmlDoc.documentElement(), jsEngine);
+    return m_document.saveParameters();
 }
 
 /*!
-  * Traverse all SVG nodes and replace content with parameter or expression value
+  * Set all parameters from a snapshot and update graphics once.
+  * Active transitions are stopped.
   *
-  * \param[in] node link to parent XML node
-  * \param[in] jsEngine link to JavaScript Engine
+  * \param[in] snapshot snapshot made by saveParameters()
+  * \return true, if all values of the snapshot were set
   */
-void ParametricSvgItem::traverseXmlNode(const QDomNode &node, QJSEngine *jsEngine)
+bool ParametricSvgItem::restoreParameters(const QByteArray &snapshot)
 {
-    QDomNode domNode = node.firstChild();
+    if(m_document.isNull()){
+        return false;
+    }
+    stopTransitions();
+    const bool isAllSet = m_document.restoreParameters(snapshot);
+    if(m_document.hasChanges()){
+        requestUpdate();
+    }
+    return isAllSet;
+}
 
-    while (!(domNode.isNull())) {
-        if (domNodeIsValid(domNode)) {
-            QDomNamedNodeMap attributesMap = domNode.attributes();
-            for(int i=0; i<attributesMap.count(); ++i){
-                QDomNode attribut = attributesMap.item(i);
-                if(attribut.nodeName().startsWith(getNamespace())){
-                    QString attName = getLocalName(attribut.nodeName());
-                    QString attValue = attribut.nodeValue();
-                    QJSValue jsResult = jsEngine->evaluate(attValue);
+/*!
+  * Set several parameter values and update graphics once
+  *
+  * \param[in] values parameter values by names
+  * \return true if all parameters were set
+  */
+bool ParametricSvgItem::setParameters(const QVariantMap &values)
+{
+    bool isAllSet = true;
+    bool isAnySet = false;
+
+    beginUpdate();
+    QVariantMap::const_iterator i = values.constBegin();
+    for (; i != values.constEnd(); ++i) {
+        bool isParamWasSet = setParameter(i.key(), i.value());
+        isAllSet = isAllSet && isParamWasSet;
+        isAnySet = isAnySet || isParamWasSet;
+    }
+    if(isAnySet){
+        requestUpdate();
+    }
+    endUpdate();
 
-                    addError(jsResult.isError(), jsResult.property("message").toString());
-                    if(jsResult.isError()){
-                        continue;
-                    }
+    return isAllSet;
+}
 
-                    QDomNode nodeForPatch;
-                    if (attName.toLower() == "text") {
-                        nodeForPatch = domNode.firstChild();
-                    }else {
-                        nodeForPatch = domNode.toElement().attributeNode(attName);
-                    }
-                    if (!nodeForPatch.isNull()) {
-                       nodeForPatch.setNodeValue(jsResult.toString());
-                    }
-                }
-            }
-        }
+/*!
+  * Start a batch of changes. Graphics are updated once by the outermost endUpdate().
+  */
+void ParametricSvgItem::beginUpdate()
+{
+    ++m_updateLevel;
+}
 
-        traverseXmlNode(domNode, jsEngine);
-        domNode = domNode.nextSibling();
+/*!
+  * Finish a batch of changes and update graphics, if parameters were changed
+  */
+void ParametricSvgItem::endUpdate()
+{
+    if(m_updateLevel == 0){
+        return;
+    }
+    --m_updateLevel;
+    if(m_updateLevel == 0 && m_isUpdatePending){
+        requestUpdate();
     }
 }
 
 /*!
-  * Check that the node is not empty and has attributes
+  * Set when graphics are updated after a parameter change.
+  * In DeferredUpdate mode all changes made until the next
+  * event loop iteration are evaluated together.
   *
-  * \param[in] node link to XML node
-  * \return true if valid
+  * \param[in] mode update mode
   */
-bool ParametricSvgItem::domNodeIsValid(const QDomNode &node)
+void ParametricSvgItem::setUpdateMode(ParametricSvgItem::UpdateMode mode)
 {
-    return !node.isNull() && node.isElement() && node.hasAttributes();
+    m_updateMode = mode;
+    if(m_updateMode == ImmediateUpdate && m_isUpdatePending){
+        requestUpdate();
+    }
 }
 
-QString ParametricSvgItem::getLocalName(const QString &qName)
+ParametricSvgItem::UpdateMode ParametricSvgItem::updateMode() const
 {
-    return getToken(qName, 1);
+    return m_updateMode;
 }
 
-QString ParametricSvgItem::getUri(const QString &qName)
+/*!
+  * Mark the item dirty and evaluate it now or later according to the update mode
+  */
+void ParametricSvgItem::requestUpdate()
 {
-    return getToken(qName, 0);
+    m_isUpdatePending = true;
+    if(m_updateLevel > 0){
+        return;
+    }
+
+    if(m_updateMode == DeferredUpdate){
+        if(!m_isUpdateScheduled){
+            m_isUpdateScheduled = true;
+            QMetaObject::invokeMethod(this, "flushUpdate", Qt::QueuedConnection);
+        }
+        return;
+    }
+
+    flushUpdate();
 }
 
-QString ParametricSvgItem::getToken(const QString &qName, const int index, const QString delimeter)
+/*!
+  * Evaluate pending changes and update graphics
+  */
+void ParametricSvgItem::flushUpdate()
 {
-    if(index < 0){
-        return QString();
+    m_isUpdateScheduled = false;
+    if(!m_isUpdatePending || m_updateLevel > 0){
+        return;
     }
-    QStringList list = qName.split(delimeter);
-    if(list.size() < 2){
-        return QString();
+    m_isUpdatePending = false;
+
+    if(m_document.isNull()){
+        return;
     }
 
-    return list[index];
+    //Изменения остаются в документе до появления элемента на экране
+    if(isHiddenByLod()){
+        m_isUpdatePending = true;
+        m_isLodDeferred = true;
+        return;
+    }
+    evaluatePending();
 }
 
 /*!
-  * Slot for changing parameter by qreal value
-  *
-  * \param[in] pName parameter name
-  * \param[in] d value
+  * Evaluate changes in the current thread or start evaluation in a worker thread
   */
-void ParametricSvgItem::changeParamByName(const QString &pName, qreal d)
+void ParametricSvgItem::evaluatePending()
 {
-    if(pName.isEmpty()){
+    if(m_evaluationMode == SynchronousEvaluation){
+        m_document.resetStats();
+        m_document.evaluateChanged();
+        //При превышении времени остаётся последнее полное изображение
+        if(!m_document.isOverrun()){
+            //Изменились только пути, которые рисуются без рендерера
+            if(isInstanced() && !m_isRendererOutdated && !m_document.isOverlayChanged()){
+                m_nativePaths = m_document.nativePaths();
+                m_lodPixmap = QPixmap();
+                update();
+            }else{
+                redraw();
+            }
+        }
+        publishStats();
+        publishDiagnostics();
         return;
     }
-    updateByParameter(pName, QVariant(d));
+
+    QVariantMap changes = m_document.takeChangedParameters();
+    for (QVariantMap::const_iterator i = changes.constBegin(); i != changes.constEnd(); ++i) {
+        m_asyncChanges.insert(i.key(), i.value());
+    }
+
+    //Более новый результат из кэша заменяет выполняющееся вычисление
+    if(useCachedRenderer()){
+        ++m_generation;
+        return;
+    }
+    if(m_evaluationWatcher->isRunning()){
+        m_isUpdatePending = true;
+        return;
+    }
+    startEvaluation();
 }
 
-int ParametricSvgItem::type() const
+/*!
+  * Set time limit of one JavaScript evaluation of expressions and attributes.
+  * Overruns are reported by errors(), and the last graphics stay visible.
+  *
+  * \param[in] msecs limit in milliseconds; 0 for no limit
+  */
+void ParametricSvgItem::setEvaluationBudget(int msecs)
 {
-    return Type;
+    m_document.setEvaluationBudget(msecs);
+}
+
+int ParametricSvgItem::evaluationBudget() const
+{
+    return m_document.evaluationBudget();
 }
 
 /*!
-  * Set parameter value
+  * Set time limit of evaluation of one update.
+  * Overruns are reported by errors(), and the last graphics stay visible.
   *
-  * \param[in] pName paramter name
-  * \param[in] value parameter value
-  * \return true in success
+  * \param[in] msecs limit in milliseconds; 0 for no limit
   */
-bool ParametricSvgItem::setParameter(const QString &pName, QVariant value)
+void ParametricSvgItem::setUpdateBudget(int msecs)
 {
-    if(pName.isEmpty()){
-        return false;
+    m_document.setUpdateBudget(msecs);
+}
+
+int ParametricSvgItem::updateBudget() const
+{
+    return m_document.updateBudget();
+}
+
+/*!
+  * Enable collection of phase timings and counters. After each update
+  * the statistics are sent by statsUpdated(). Phases are also recorded
+  * by ParametricSvgTrace, if it is enabled.
+  *
+  * \param[in] isEnabled true to collect
+  */
+void ParametricSvgItem::setStatsEnabled(bool isEnabled)
+{
+    m_document.setStatsEnabled(isEnabled);
+}
+
+bool ParametricSvgItem::isStatsEnabled() const
+{
+    return m_document.isStatsEnabled();
+}
+
+/*!
+  * Get statistics of the last update
+  *
+  * \return statistics. Empty, if disabled
+  */
+ParametricSvgStats ParametricSvgItem::stats() const
+{
+    return m_stats;
+}
+
+/*!
+  * Send statistics of the finished update
+  */
+void ParametricSvgItem::publishStats()
+{
+    const ParametricSvgStats *stats = m_document.stats();
+    if(!stats){
+        return;
     }
-    if(!value.isValid() || value.isNull()){
-        return false;
+    m_stats = *stats;
+    emit statsUpdated(m_stats);
+}
+
+/*!
+  * Set the thread, where parameter changes are evaluated.
+  * In AsynchronousEvaluation mode expressions are evaluated and SVG is
+  * loaded in a worker thread; the last graphics stay visible until then.
+  * Loading of content by setContent() is always synchronous.
+  *
+  * \param[in] mode evaluation mode
+  */
+void ParametricSvgItem::setEvaluationMode(ParametricSvgItem::EvaluationMode mode)
+{
+    if(m_evaluationMode == mode){
+        return;
     }
-    if(m_parameters.contains(pName)){
-        if (value.type() == QVariant::String) {
-            m_parameters[pName].value = value;
-            return true;
-        }
-        if(isNumberValueInRange(m_parameters.value(pName), value)){
-            m_parameters[pName].value = value;
-            return true;
-        }    
+    m_evaluationMode = mode;
+
+    //Результат выполняющегося вычисления не используется
+    ++m_generation;
+    m_asyncDocument.clear();
+    m_asyncChanges.clear();
+
+    if(m_evaluationMode == SynchronousEvaluation && !m_document.isNull()){
+        //Документ элемента не пересчитывался в асинхронном режиме
+        m_document.evaluateAll();
+        m_isUpdatePending = false;
+        m_isLodDeferred = false;
+        redraw();
+        publishDiagnostics();
     }
+}
 
-    return false;
+ParametricSvgItem::EvaluationMode ParametricSvgItem::evaluationMode() const
+{
+    return m_evaluationMode;
 }
 
-bool ParametricSvgItem::isNumberValueInRange(const ParametricSvgItem::Parameter &param, const QVariant value)
+/*!
+  * Set level of detail. In ViewportLod mode parameter changes of items,
+  * which are outside of all views or smaller than lodThreshold() there,
+  * are not evaluated until the item is painted in full size.
+  * Small items are painted from a low resolution image of the last
+  * evaluated graphics or as a bounding box.
+  *
+  * \param[in] mode level of detail mode
+  */
+void ParametricSvgItem::setLodMode(ParametricSvgItem::LodMode mode)
 {
-    if(value.toReal() >= param.min
-            && value.toReal() <= param.max){
-        return true;
+    if(m_lodMode == mode){
+        return;
+    }
+    m_lodMode = mode;
+    m_lodPixmap = QPixmap();
+    if(m_lodMode == NoLod && m_isLodDeferred){
+        updateDeferred();
     }
-    return false;
+    update();
 }
 
-void ParametricSvgItem::addError(bool isError, QString message)
+ParametricSvgItem::LodMode ParametricSvgItem::lodMode() const
 {
-    if(isError)
-        m_errors.append(message);
+    return m_lodMode;
 }
 
 /*!
-  * Set parameter value, evaluate and update graphics, using calculated values
+  * Set minimal size on screen for painting in full details
   *
-  * \param[in] pName parameter name
-  * \param[in] value parameter value
-  * \return true in success
+  * \param[in] pixels size of the largest side in device independent pixels
   */
-bool ParametricSvgItem::updateByParameter(const QString &pName, QVariant value)
+void ParametricSvgItem::setLodThreshold(qreal pixels)
 {
-    bool isParamWasSet = setParameter(pName, value);
-    if(!isParamWasSet){
-        return false;
+    m_lodThreshold = qMax<qreal>(pixels, 0.0);
+    m_lodPixmap = QPixmap();
+    update();
+}
+
+qreal ParametricSvgItem::lodThreshold() const
+{
+    return m_lodThreshold;
+}
+
+/*!
+  * Check whether parameter changes wait for the item to become visible
+  *
+  * \return true, if the graphics do not show the current parameter values
+  */
+bool ParametricSvgItem::isLodDeferred() const
+{
+    return m_isLodDeferred;
+}
+
+/*!
+  * Evaluate changes deferred by level of detail
+  */
+void ParametricSvgItem::updateDeferred()
+{
+    if(!m_isLodDeferred){
+        return;
+    }
+    m_isLodDeferred = false;
+    if(!m_isUpdatePending || m_updateLevel > 0 || m_document.isNull()){
+        return;
     }
+    m_isUpdatePending = false;
+    evaluatePending();
+}
 
-    evaluateAll();
-    redraw();
+/*!
+  * Check that no view shows the item in full details
+  *
+  * \return false, if level of detail is disabled or the item is not in a view
+  */
+bool ParametricSvgItem::isHiddenByLod() const
+{
+    if(m_lodMode == NoLod || !scene() || scene()->views().isEmpty()){
+        return false;
+    }
+    if(!isVisible()){
+        return true;
+    }
 
+    const QRectF sceneRect = sceneBoundingRect();
+    foreach (QGraphicsView *view, scene()->views()) {
+        if(!view->isVisible()){
+            continue;
+        }
+        const QRectF visibleRect = view->mapToScene(view->viewport()->rect()).boundingRect();
+        if(!visibleRect.intersects(sceneRect)){
+            continue;
+        }
+        const QRectF viewRect = view->mapFromScene(sceneRect).boundingRect();
+        if(qMax(viewRect.width(), viewRect.height()) >= m_lodThreshold){
+            return false;
+        }
+    }
     return true;
 }
 
+/*!
+  * Paint small item from low resolution image or as a bounding box
+  */
+void ParametricSvgItem::paintLod(QPainter *painter, const QStyleOptionGraphicsItem *option)
+{
+    const QRectF bounds = boundingRect();
+
+    //Изображение создаётся один раз для каждого рендерера
+    if(m_lodPixmap.isNull() && m_renderer && m_renderer->isValid() && !bounds.isEmpty()){
+        const qreal side = qMax<qreal>(qCeil(m_lodThreshold * painter->device()->devicePixelRatioF()), 1.0);
+        const QSize size = (bounds.size() * (side / qMax(bounds.width(), bounds.height()))).toSize()
+                .expandedTo(QSize(1, 1));
+        m_lodPixmap = QPixmap(size);
+        m_lodPixmap.fill(Qt::transparent);
+        QPainter pixmapPainter(&m_lodPixmap);
+        if(isInstanced()){
+            m_staticRenderer->render(&pixmapPainter, QRectF(m_lodPixmap.rect()));
+            paintNativePaths(&pixmapPainter, QRectF(m_lodPixmap.rect()));
+        }
+        m_renderer->render(&pixmapPainter, QRectF(m_lodPixmap.rect()));
+    }
+
+    if(!m_lodPixmap.isNull()){
+        painter->drawPixmap(bounds, m_lodPixmap, QRectF(m_lodPixmap.rect()));
+    }else{
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(option->palette.mid());
+        painter->drawRect(bounds);
+    }
+    paintSelection(painter, option);
+}
+
+/*!
+  * Check whether evaluation in a worker thread is running
+  *
+  * \return true, if the graphics will be updated later
+  */
+bool ParametricSvgItem::isEvaluating() const
+{
+    return m_evaluationWatcher->isRunning();
+}
+
 /*!
   * Return parameter value type
   *
@@ -531,10 +1418,7 @@ bool ParametricSvgItem::updateByParameter(const QString &pName, QVariant value)
   */
 QVariant::Type ParametricSvgItem::parameterType(const QString &pName) const
 {
-    if(parameterIsExist(pName)){
-        return m_parameters[pName].value.type();
-    }
-    return QVariant::Invalid;
+    return m_document.parameterType(pName);
 }
 
 /*!
@@ -545,10 +1429,7 @@ QVariant::Type ParametricSvgItem::parameterType(const QString &pName) const
   */
 QVariant ParametricSvgItem::parameterValue(const QString &pName) const
 {
-    if(parameterIsExist(pName)){
-        return m_parameters[pName].value;
-    }
-    return QVariant();
+    return m_document.parameterValue(pName);
 }
 
 /*!
@@ -559,10 +1440,7 @@ QVariant ParametricSvgItem::parameterValue(const QString &pName) const
   */
 qreal ParametricSvgItem::parameterMin(const QString &pName) const
 {
-    if(parameterIsExist(pName)){
-        return m_parameters[pName].min;
-    }
-    return 0.0;
+    return m_document.parameterMin(pName);
 }
 
 /*!
@@ -573,10 +1451,7 @@ qreal ParametricSvgItem::parameterMin(const QString &pName) const
   */
 qreal ParametricSvgItem::parameterMax(const QString &pName) const
 {
-    if(parameterIsExist(pName)){
-        return m_parameters[pName].max;
-    }
-    return 0.0;
+    return m_document.parameterMax(pName);
 }
 
 /*!
@@ -587,7 +1462,7 @@ qreal ParametricSvgItem::parameterMax(const QString &pName) const
   */
 bool ParametricSvgItem::parameterIsExist(const QString &pName) const
 {
-    return m_parameters.contains(pName);
+    return m_document.parameterIsExist(pName);
 }
 
 /*!
@@ -597,7 +1472,7 @@ bool ParametricSvgItem::parameterIsExist(const QString &pName) const
   */
 QStringList ParametricSvgItem::parameterNames() const
 {
-    return m_parameters.keys();
+    return m_document.parameterNames();
 }
 
 /*!
@@ -607,20 +1482,45 @@ QStringList ParametricSvgItem::parameterNames() const
   */
 int ParametricSvgItem::parametersCount()
 {
-    return m_parameters.count();
+    return m_document.parametersCount();
 }
 
+/*!
+  * Check whether the last update had errors
+  *
+  * \return true, if there were errors
+  */
 bool ParametricSvgItem::isError()
 {
-    return m_errors.size() > 0;
+    return m_document.isError();
 }
 
-QStringList &ParametricSvgItem::errors()
+/*!
+  * Get messages of errors of the last update
+  *
+  * \return list of messages
+  */
+QStringList ParametricSvgItem::errors() const
 {
-    return m_errors;
+    return m_document.errors();
 }
 
+/*!
+  * Get log of recent distinct errors with their sources and repetitions
+  *
+  * \return errors from the oldest
+  */
+QVector<ParametricSvgDiagnostic> ParametricSvgItem::diagnostics() const
+{
+    return m_document.diagnostics().entries();
+}
 
-
-
-
+/*!
+  * Send errors, which are not in the log yet
+  */
+void ParametricSvgItem::publishDiagnostics()
+{
+    foreach (const ParametricSvgDiagnostic &diagnostic, m_document.diagnostics().takeNew()) {
+        emit errorOccurred(diagnostic);
+    }
+}
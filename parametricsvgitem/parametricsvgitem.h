@@ -2,74 +2,192 @@
 #define PARAMETRICSVGITEM_H
 
 
+#include <QEasingCurve>
+#include <QFutureWatcher>
 #include <QGraphicsSvgItem>
-#include <QDomDocument>
+#include <QImage>
+#include <QPixmap>
+#include <QSharedPointer>
+#include "parametricsvgdocument.h"
 
-class QJSEngine;
+class QSvgRenderer;
 
 class ParametricSvgItem : public QGraphicsSvgItem
 {
     Q_OBJECT
-private:
-    enum { Type = UserType + 845 };
+public:
+    //Использование общего кэша ParametricSvgRenderCache
+    enum RenderCacheMode {
+        NoRenderCache,
+        RendererCache,
+        RendererAndPixmapCache
+    };
 
-    struct Parameter
-    {
-        QVariant value;        
-        qreal min;
-        qreal max;
-        QString name;
+    //Момент пересчёта после изменения параметров
+    enum UpdateMode {
+        ImmediateUpdate,
+        DeferredUpdate
     };
 
-    struct Expression {
-        QString name;
-        QString value;
+    //Поток, в котором выполняется пересчёт
+    enum EvaluationMode {
+        SynchronousEvaluation,
+        AsynchronousEvaluation
     };
 
-    //Размеры компонента
-    QMap<QString, Parameter> m_parameters;
-    //Выражения JS
-    QList<Expression> m_expressions;
-    QDomDocument m_xmlDoc;
-    QString m_namespace;
-    QStringList m_errors;
+    //Пересчёт элементов вне области просмотра и мелких элементов
+    enum LodMode {
+        NoLod,
+        //Пересчёт откладывается до появления в области просмотра в достаточном размере
+        ViewportLod
+    };
 
+    //Растровое изображение элемента для повторной отрисовки без SVG
+    enum RasterCacheMode {
+        NoRasterCache,
+        RasterCache,
+        //Изображение для нового масштаба отрисовывается в рабочем потоке
+        BackgroundRasterCache
+    };
 
-    //методы
-    bool readXmlFromFile(const QString &fname);
-    bool readParameters(const QDomNode &node);
-    bool readExpressions(const QDomNode &node);
+private:
+    enum { Type = UserType + 845 };
 
-    QString getUri(const QString &qName);
-    QString getLocalName(const QString &qName);
-    QString getToken(const QString &qName, const int index, const QString delimeter = ":");
+    //Результат вычисления в рабочем потоке
+    struct EvaluationResult {
+        int generation = 0;
+        QByteArray renderKey;
+        //Принадлежит потоку элемента
+        QSharedPointer<QSvgRenderer> renderer;
+        int dataSize = 0;
+        QVariantMap parameters;
+        QVector<ParametricSvgDiagnostic> diagnostics;
+        bool hasStats = false;
+        ParametricSvgStats stats;
+        //Только для отрисовки изображения в рабочем потоке
+        QByteArray svgData;
+        //Режим экземпляров: рендерер не создаётся, если изменились только пути
+        QVector<QPainterPath> nativePaths;
+    };
 
-    void addParameter(const QString &pName, const Parameter &param);
-    void addExpression(const Expression &exp);
+    //Плавное изменение числового параметра
+    struct Transition {
+        int handle;
+        double from;
+        double to;
+        //Ограничения параметра
+        double min;
+        double max;
+        qint64 start;
+        int duration;
+        QEasingCurve easing;
+    };
 
-    void evaluateParameters(QJSEngine *jsEngine);
-    void evaluateExpressions(QJSEngine *jsEngine);
+    //Графика, масштаб и плотность пикселей растрового изображения
+    struct RasterKey {
+        int version = -1;
+        qreal scale = 0.0;
+        qreal devicePixelRatio = 0.0;
 
-    void evaluateXmlDocument(QJSEngine *jsEngine);
-    void traverseXmlNode(const QDomNode &node, QJSEngine *jsEngine);
-    bool domNodeIsValid(const QDomNode &node);
-    Parameter domNodeToParameter(const QDomNode &node);
-    Expression domNodeToExpression(const QDomNode &node);
+        bool operator==(const RasterKey &other) const {
+            return version == other.version
+                    && qFuzzyCompare(scale, other.scale)
+                    && qFuzzyCompare(devicePixelRatio, other.devicePixelRatio);
+        }
+    };
 
-    void evaluateAll();
-    void redraw();
+    //Параметры, выражения и вычисленный SVG
+    ParametricSvgDocument m_document;
+    QSharedPointer<QSvgRenderer> m_renderer;
+    //Рендерер из кэша или общий с копией элемента; не изменяется
+    mutable bool m_isRendererShared;
+    RenderCacheMode m_renderCacheMode;
+    //Ключ записи кэша для текущих значений параметров
+    QByteArray m_renderKey;
+    //Пакетное и отложенное обновление
+    UpdateMode m_updateMode;
+    int m_updateLevel;
+    bool m_isUpdatePending;
+    bool m_isUpdateScheduled;
+    //Асинхронный пересчёт: копия документа для рабочих потоков
+    EvaluationMode m_evaluationMode;
+    QSharedPointer<ParametricSvgDocument> m_asyncDocument;
+    //Изменения, ещё не переданные копии документа
+    QVariantMap m_asyncChanges;
+    QFutureWatcher<EvaluationResult> *m_evaluationWatcher;
+    //Номер содержимого; устаревшие результаты отбрасываются
+    int m_generation;
+    //Статистика последнего обновления
+    ParametricSvgStats m_stats;
+    //Уровень детализации
+    LodMode m_lodMode;
+    //Минимальный размер на экране в пикселях для полной отрисовки
+    qreal m_lodThreshold;
+    //Изменения ожидают появления элемента в области просмотра
+    bool m_isLodDeferred;
+    //Уменьшенное изображение для мелкого элемента
+    QPixmap m_lodPixmap;
+    //Растровый кэш
+    RasterCacheMode m_rasterCacheMode;
+    //Номер графики; меняется при каждой смене рендерера
+    int m_contentVersion;
+    QImage m_rasterImage;
+    RasterKey m_rasterKey;
+    //SVG текущей графики для отрисовки в рабочем потоке
+    QByteArray m_rasterData;
+    QFutureWatcher<QImage> *m_rasterWatcher;
+    RasterKey m_rasterJobKey;
+    //Активные переходы параметров
+    QVector<Transition> m_transitions;
+    //Общий рендерер статической части шаблона; отсутствует без режима экземпляров
+    bool m_isInstancingEnabled;
+    QSharedPointer<QSvgRenderer> m_staticRenderer;
+    //Пути, которые рисуются без QSvgRenderer между общей частью и наложением
+    QVector<QPainterPath> m_nativePaths;
+    //Рендерер не соответствует документу независимо от изменений наложения
+    bool m_isRendererOutdated;
+    //Перезагрузка при изменении файла шаблона
+    bool m_isHotReloadEnabled;
 
-    void setNamespace(QString m) {m_namespace = m;}
-    QString getNamespace() {return m_namespace;}
 
-    void expressionValuesToParameterValues(QJSEngine *jsEngine);
-    bool isNumberValueInRange(const Parameter &param, const QVariant value);
+    //методы
+    void redraw();
+    void useRenderer(const QSharedPointer<QSvgRenderer> &renderer);
+    void requestUpdate();
+    void startEvaluation();
+    bool useCachedRenderer();
+    void publishStats();
+    void publishDiagnostics();
+    void evaluatePending();
+    void showContent();
+    void updateStaticRenderer();
+    bool isInstanced() const;
+    const QByteArray &svgData();
+    QByteArray currentRenderKey() const;
+    bool hasNativePaths() const;
+    void paintNativePaths(QPainter *painter, const QRectF &bounds);
+    bool isHiddenByLod() const;
+    void paintLod(QPainter *painter, const QStyleOptionGraphicsItem *option);
+    bool paintRaster(QPainter *painter, const QStyleOptionGraphicsItem *option);
+    void paintSelection(QPainter *painter, const QStyleOptionGraphicsItem *option);
+    void startRasterization(const RasterKey &key, const QSize &size);
+    static qreal rasterScale(qreal scale);
+    static QImage rasterize(QSvgRenderer *renderer, const QSize &size);
+
+private slots:
+    void applyEvaluationResult();
+    void updateDeferred();
+    void applyRasterImage();
 
-    void addError(bool isError, QString message);
+signals:
+    void statsUpdated(const ParametricSvgStats &stats);
+    void transitionsFinished();
+    void errorOccurred(const ParametricSvgDiagnostic &diagnostic);
 
 
 public slots:
     void changeParamByName(const QString &pName, qreal d);
+    void flushUpdate();
 
 public:
     ParametricSvgItem(QGraphicsItem *parent = nullptr, const QString namespaceName = "parametric");
@@ -77,10 +195,61 @@ public:
     ~ParametricSvgItem();
 
     int type() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
     bool setContent(const QString &fname);
+    bool reload();
+    QSharedPointer<const ParametricSvgTemplate> svgTemplate() const;
+    ParametricSvgItem *clone(QGraphicsItem *parent = nullptr) const;
+
+    void setHotReloadEnabled(bool isEnabled);
+    bool isHotReloadEnabled() const;
 
     bool setParameter(const QString &pName, QVariant value);
     bool updateByParameter(const QString &pName, QVariant value);
+    bool setParameters(const QVariantMap &values);
+    int parameterHandle(const QString &pName) const;
+    bool setParameter(int handle, double value);
+    bool updateByParameter(int handle, double value);
+    double parameterNumber(int handle) const;
+    QByteArray saveParameters() const;
+    bool restoreParameters(const QByteArray &snapshot);
+
+    bool animateParameter(const QString &pName, double value, int msecs,
+                          const QEasingCurve &easing = QEasingCurve(QEasingCurve::InOutQuad));
+    bool animateParameter(int handle, double value, int msecs,
+                          const QEasingCurve &easing = QEasingCurve(QEasingCurve::InOutQuad));
+    void stopTransitions();
+    bool isAnimating() const;
+    bool advanceTransitions(qint64 time);
+
+    void beginUpdate();
+    void endUpdate();
+    void setUpdateMode(UpdateMode mode);
+    UpdateMode updateMode() const;
+    void setEvaluationMode(EvaluationMode mode);
+    EvaluationMode evaluationMode() const;
+    bool isEvaluating() const;
+
+    void setEvaluationBudget(int msecs);
+    int evaluationBudget() const;
+    void setUpdateBudget(int msecs);
+    int updateBudget() const;
+
+    void setStatsEnabled(bool isEnabled);
+    bool isStatsEnabled() const;
+    ParametricSvgStats stats() const;
+
+    void setLodMode(LodMode mode);
+    LodMode lodMode() const;
+    void setLodThreshold(qreal pixels);
+    qreal lodThreshold() const;
+    bool isLodDeferred() const;
+
+    void setInstancingEnabled(bool isEnabled);
+    bool isInstancingEnabled() const;
+
+    void setRasterCacheMode(RasterCacheMode mode);
+    RasterCacheMode rasterCacheMode() const;
 
     QVariant::Type parameterType(const QString &pName) const;
     QVariant parameterValue(const QString &pName) const;
@@ -90,8 +259,12 @@ public:
     QStringList parameterNames() const;
     int parametersCount();
 
+    void setRenderCacheMode(RenderCacheMode mode);
+    RenderCacheMode renderCacheMode() const;
+
     bool isError();
-    QStringList &errors();
+    QStringList errors() const;
+    QVector<ParametricSvgDiagnostic> diagnostics() const;
 };
 
 #endif // PARAMETRICSVGITEM_H
@@ -0,0 +1,19 @@
+# Parametric SVG graphics item
+
+include(parametricsvgdocument.pri)
+
+QT += svg widgets concurrent
+
+SOURCES += \
+    $$PWD/parametricsvganimationclock.cpp \
+    $$PWD/parametricsvgdatabinding.cpp \
+    $$PWD/parametricsvgitem.cpp \
+    $$PWD/parametricsvgreloader.cpp \
+    $$PWD/parametricsvgrendercache.cpp
+
+HEADERS += \
+    $$PWD/parametricsvganimationclock.h \
+    $$PWD/parametricsvgdatabinding.h \
+    $$PWD/parametricsvgitem.h \
+    $$PWD/parametricsvgreloader.h \
+    $$PWD/parametricsvgrendercache.h
@@ -0,0 +1,599 @@
+/*!
+ * \class ParametricSvgPath
+ * SVG path data converted to QPainterPath without QSvgRenderer. A template
+ * literal of the `d` attribute, whose substitutions are whole numbers,
+ * is compiled into commands with numeric slots. Evaluation updates only
+ * the slots, and the path is built again only when they change.
+ */
+#include "parametricsvgpath.h"
+#include <qmath.h>
+
+ParametricSvgPath::ParametricSvgPath():
+    m_isValid(false),
+    m_isCompiled(false),
+    m_fillRule(Qt::WindingFill),
+    m_isPathChanged(true),
+    m_piece(0),
+    m_position(0)
+{
+}
+
+/*!
+  * Compile template literal of path data. Substitutions must stand
+  * in place of numbers and be evaluated by the native evaluator.
+  *
+  * \param[in] source template literal, e.g. `M 0 0 H ${Value1}`
+  * \param[in] names name table of the template
+  * \return false, if the path must be built from the evaluated string
+  */
+bool ParametricSvgPath::compile(const QString &source, const QHash<QString, int> &names)
+{
+    m_pieces.clear();
+    m_isValid = splitTemplate(source, names) && parsePieces();
+    m_isCompiled = m_isValid;
+    m_pieces.clear();
+    if(!m_isValid){
+        m_commands.clear();
+        m_arguments.clear();
+        m_slots.clear();
+    }
+    m_isPathChanged = true;
+    return m_isValid;
+}
+
+/*!
+  * Parse evaluated path data. As in SVG, the path is drawn
+  * up to the first error.
+  *
+  * \param[in] data value of the `d` attribute
+  * \return true, if there are no errors
+  */
+bool ParametricSvgPath::parse(const QString &data)
+{
+    Piece piece;
+    piece.text = data;
+    piece.isSlot = false;
+    m_pieces.clear();
+    m_pieces.append(piece);
+    m_isValid = parsePieces();
+    m_isCompiled = false;
+    m_slots.clear();
+    m_pieces.clear();
+    m_isPathChanged = true;
+    return m_isValid;
+}
+
+bool ParametricSvgPath::isValid() const
+{
+    return m_isValid;
+}
+
+/*!
+  * Check that the path is compiled from the template literal
+  *
+  * \return true, if evaluate() updates the path
+  */
+bool ParametricSvgPath::isCompiled() const
+{
+    return m_isCompiled;
+}
+
+int ParametricSvgPath::slotsCount() const
+{
+    return m_slots.size();
+}
+
+/*!
+  * Evaluate numeric slots of the compiled path
+  *
+  * \param[in] environment values of parameters and expressions
+  * \param[out] error message on failure
+  * \return false, if a slot is not evaluated to a finite number
+  */
+bool ParametricSvgPath::evaluate(const QVector<ParametricExpression::Value> &environment, QString *error)
+{
+    for (int i = 0; i < m_slots.size(); ++i) {
+        const Slot &slot = m_slots.at(i);
+        ParametricExpression::Value result;
+        if(!slot.expression.evaluate(environment, &result, error)){
+            return false;
+        }
+        const double number = result.toNumber();
+        if(!qIsFinite(number)){
+            if(error){
+                *error = QString("Path data value %1 is not a number").arg(result.toString());
+            }
+            return false;
+        }
+        if(m_arguments.at(slot.argument) != number){
+            m_arguments[slot.argument] = number;
+            m_isPathChanged = true;
+        }
+    }
+    return true;
+}
+
+void ParametricSvgPath::setFillRule(Qt::FillRule fillRule)
+{
+    m_fillRule = fillRule;
+    m_isPathChanged = true;
+}
+
+/*!
+  * Get the path for the current values of slots
+  *
+  * \return path in user coordinates of the SVG element
+  */
+const QPainterPath &ParametricSvgPath::path()
+{
+    if(m_isPathChanged){
+        buildPath();
+        m_isPathChanged = false;
+    }
+    return m_path;
+}
+
+/*!
+  * Split template literal into text and substitutions
+  *
+  * \param[in] source template literal
+  * \param[in] names name table of the template
+  * \return false, if a substitution is not a whole number or not compiled
+  */
+bool ParametricSvgPath::splitTemplate(const QString &source, const QHash<QString, int> &names)
+{
+    const QString body = source.trimmed();
+    if(body.size() < 2 || body.at(0) != QLatin1Char('`') || body.at(body.size() - 1) != QLatin1Char('`')){
+        return false;
+    }
+
+    const int end = body.size() - 1;
+    QString text;
+    int i = 1;
+    while (i < end) {
+        const QChar c = body.at(i);
+        //Экранирование и вложенные шаблоны вычисляются строкой
+        if(c == QLatin1Char('\\') || c == QLatin1Char('`')){
+            return false;
+        }
+        if(c != QLatin1Char('$') || i + 1 >= end || body.at(i + 1) != QLatin1Char('{')){
+            text.append(c);
+            ++i;
+            continue;
+        }
+
+        //Подстановка не должна продолжать число или другую подстановку
+        if(text.isEmpty() ? !m_pieces.isEmpty() : isNumberChar(text.at(text.size() - 1))){
+            return false;
+        }
+
+        int depth = 0;
+        int j = i + 2;
+        QChar quote;
+        for (; j < end; ++j) {
+            const QChar s = body.at(j);
+            if(!quote.isNull()){
+                if(s == QLatin1Char('\\')){
+                    ++j;
+                }else if(s == quote){
+                    quote = QChar();
+                }
+                continue;
+            }
+            if(s == QLatin1Char('"') || s == QLatin1Char('\'')){
+                quote = s;
+            }else if(s == QLatin1Char('`')){
+                return false;
+            }else if(s == QLatin1Char('{')){
+                ++depth;
+            }else if(s == QLatin1Char('}')){
+                if(depth == 0){
+                    break;
+                }
+                --depth;
+            }
+        }
+        if(j >= end){
+            return false;
+        }
+
+        if(!text.isEmpty()){
+            Piece piece;
+            piece.text = text;
+            piece.isSlot = false;
+            m_pieces.append(piece);
+            text.clear();
+        }
+        Piece slot;
+        slot.isSlot = true;
+        if(!slot.expression.compile(body.mid(i + 2, j - i - 2), names)){
+            return false;
+        }
+        m_pieces.append(slot);
+
+        i = j + 1;
+        if(i < end && (body.at(i).isDigit() || body.at(i) == QLatin1Char('.')
+                       || body.at(i) == QLatin1Char('e') || body.at(i) == QLatin1Char('E'))){
+            return false;
+        }
+    }
+
+    if(!text.isEmpty()){
+        Piece piece;
+        piece.text = text;
+        piece.isSlot = false;
+        m_pieces.append(piece);
+    }
+    return true;
+}
+
+/*!
+  * Parse commands and arguments of path data from the pieces
+  *
+  * \return true on success
+  */
+bool ParametricSvgPath::parsePieces()
+{
+    m_commands.clear();
+    m_arguments.clear();
+    m_slots.clear();
+    m_piece = 0;
+    m_position = 0;
+
+    bool isFirst = true;
+    while (!isAtEnd()) {
+        char command = readCommand();
+        if(command == 0 || (isFirst && command != 'M' && command != 'm')){
+            return false;
+        }
+        isFirst = false;
+
+        const int count = argumentsCount(command);
+        do {
+            Command entry;
+            entry.type = command;
+            entry.argument = m_arguments.size();
+            for (int i = 0; i < count; ++i) {
+                //Флаги дуги могут быть записаны без разделителей
+                const bool isFlag = (command == 'A' || command == 'a') && (i == 3 || i == 4);
+                if(!readArgument(isFlag)){
+                    return false;
+                }
+            }
+            m_commands.append(entry);
+            //Следующие координаты после M - это L
+            if(command == 'M'){
+                command = 'L';
+            }else if(command == 'm'){
+                command = 'l';
+            }
+        } while (count > 0 && hasArgument());
+    }
+    return true;
+}
+
+void ParametricSvgPath::skipSeparators()
+{
+    while (m_piece < m_pieces.size()) {
+        const Piece &piece = m_pieces.at(m_piece);
+        if(piece.isSlot){
+            return;
+        }
+        while (m_position < piece.text.size()
+               && (piece.text.at(m_position).isSpace() || piece.text.at(m_position) == QLatin1Char(','))) {
+            ++m_position;
+        }
+        if(m_position < piece.text.size()){
+            return;
+        }
+        ++m_piece;
+        m_position = 0;
+    }
+}
+
+bool ParametricSvgPath::isAtEnd()
+{
+    skipSeparators();
+    return m_piece >= m_pieces.size();
+}
+
+/*!
+  * Check whether the next token is a number or a substitution
+  *
+  * \return true, if the previous command is repeated
+  */
+bool ParametricSvgPath::hasArgument()
+{
+    if(isAtEnd()){
+        return false;
+    }
+    const Piece &piece = m_pieces.at(m_piece);
+    if(piece.isSlot){
+        return true;
+    }
+    const QChar c = piece.text.at(m_position);
+    return c.isDigit() || c == QLatin1Char('.') || c == QLatin1Char('+') || c == QLatin1Char('-');
+}
+
+/*!
+  * Read letter of path command
+  *
+  * \return command or 0, if the next token is not a command
+  */
+char ParametricSvgPath::readCommand()
+{
+    if(isAtEnd() || m_pieces.at(m_piece).isSlot){
+        return 0;
+    }
+    const char c = m_pieces.at(m_piece).text.at(m_position).toLatin1();
+    if(c == 0 || !QByteArray("MmZzLlHhVvCcSsQqTtAa").contains(c)){
+        return 0;
+    }
+    ++m_position;
+    return c;
+}
+
+/*!
+  * Read number, arc flag or substitution into the arguments
+  *
+  * \param[in] isFlag true for flags of arc: single 0 or 1
+  * \return false on syntax error
+  */
+bool ParametricSvgPath::readArgument(bool isFlag)
+{
+    if(isAtEnd()){
+        return false;
+    }
+    const Piece &piece = m_pieces.at(m_piece);
+    if(piece.isSlot){
+        Slot slot;
+        slot.argument = m_arguments.size();
+        slot.expression = piece.expression;
+        m_slots.append(slot);
+        m_arguments.append(0.0);
+        ++m_piece;
+        m_position = 0;
+        return true;
+    }
+
+    const QString &text = piece.text;
+    if(isFlag){
+        const QChar c = text.at(m_position);
+        if(c != QLatin1Char('0') && c != QLatin1Char('1')){
+            return false;
+        }
+        m_arguments.append(c == QLatin1Char('1') ? 1.0 : 0.0);
+        ++m_position;
+        return true;
+    }
+
+    //Число SVG: знак, цифры, дробная часть и порядок
+    int position = m_position;
+    if(position < text.size() && (text.at(position) == QLatin1Char('+') || text.at(position) == QLatin1Char('-'))){
+        ++position;
+    }
+    int digits = 0;
+    while (position < text.size() && text.at(position).isDigit()) {
+        ++position;
+        ++digits;
+    }
+    if(position < text.size() && text.at(position) == QLatin1Char('.')){
+        ++position;
+        while (position < text.size() && text.at(position).isDigit()) {
+            ++position;
+            ++digits;
+        }
+    }
+    if(digits == 0){
+        return false;
+    }
+    if(position < text.size() && (text.at(position) == QLatin1Char('e') || text.at(position) == QLatin1Char('E'))){
+        int exponent = position + 1;
+        if(exponent < text.size() && (text.at(exponent) == QLatin1Char('+') || text.at(exponent) == QLatin1Char('-'))){
+            ++exponent;
+        }
+        if(exponent < text.size() && text.at(exponent).isDigit()){
+            while (exponent < text.size() && text.at(exponent).isDigit()) {
+                ++exponent;
+            }
+            position = exponent;
+        }
+    }
+
+    bool ok = false;
+    const double value = text.midRef(m_position, position - m_position).toDouble(&ok);
+    if(!ok){
+        return false;
+    }
+    m_arguments.append(value);
+    m_position = position;
+    return true;
+}
+
+/*!
+  * Build QPainterPath from commands and current arguments
+  */
+void ParametricSvgPath::buildPath()
+{
+    m_path = QPainterPath();
+    m_path.setFillRule(m_fillRule);
+
+    QPointF current;
+    QPointF start;
+    //Контрольная точка предыдущей кривой для команд S и T
+    QPointF control;
+    char previous = 0;
+
+    foreach (const Command &command, m_commands) {
+        const double *a = m_arguments.constData() + command.argument;
+        const bool isRelative = command.type >= 'a';
+        const QPointF origin = isRelative ? current : QPointF();
+        const char type = isRelative ? command.type - ('a' - 'A') : command.type;
+
+        switch (type) {
+        case 'M':
+            current = origin + QPointF(a[0], a[1]);
+            start = current;
+            m_path.moveTo(current);
+            break;
+        case 'L':
+            current = origin + QPointF(a[0], a[1]);
+            m_path.lineTo(current);
+            break;
+        case 'H':
+            current.setX(origin.x() + a[0]);
+            m_path.lineTo(current);
+            break;
+        case 'V':
+            current.setY(origin.y() + a[0]);
+            m_path.lineTo(current);
+            break;
+        case 'C':
+            control = origin + QPointF(a[2], a[3]);
+            current = origin + QPointF(a[4], a[5]);
+            m_path.cubicTo(origin + QPointF(a[0], a[1]), control, current);
+            break;
+        case 'S': {
+            const QPointF first = previous == 'C' || previous == 'S' ? current * 2 - control : current;
+            control = origin + QPointF(a[0], a[1]);
+            current = origin + QPointF(a[2], a[3]);
+            m_path.cubicTo(first, control, current);
+            break;
+        }
+        case 'Q':
+            control = origin + QPointF(a[0], a[1]);
+            current = origin + QPointF(a[2], a[3]);
+            m_path.quadTo(control, current);
+            break;
+        case 'T':
+            control = previous == 'Q' || previous == 'T' ? current * 2 - control : current;
+            current = origin + QPointF(a[0], a[1]);
+            m_path.quadTo(control, current);
+            break;
+        case 'A': {
+            const QPointF to = origin + QPointF(a[5], a[6]);
+            addArc(m_path, current, a[0], a[1], a[2], a[3] != 0.0, a[4] != 0.0, to);
+            current = to;
+            break;
+        }
+        case 'Z':
+            m_path.closeSubpath();
+            current = start;
+            break;
+        }
+        previous = type;
+    }
+}
+
+/*!
+  * Get number of arguments of path command
+  *
+  * \param[in] command letter of command
+  * \return number of arguments
+  */
+int ParametricSvgPath::argumentsCount(char command)
+{
+    switch (command) {
+    case 'Z': case 'z':
+        return 0;
+    case 'H': case 'h': case 'V': case 'v':
+        return 1;
+    case 'M': case 'm': case 'L': case 'l': case 'T': case 't':
+        return 2;
+    case 'S': case 's': case 'Q': case 'q':
+        return 4;
+    case 'C': case 'c':
+        return 6;
+    case 'A': case 'a':
+        return 7;
+    }
+    return 0;
+}
+
+bool ParametricSvgPath::isNumberChar(QChar c)
+{
+    return c.isDigit() || c == QLatin1Char('.') || c == QLatin1Char('+') || c == QLatin1Char('-')
+            || c == QLatin1Char('e') || c == QLatin1Char('E');
+}
+
+/*!
+  * Add elliptical arc of SVG as cubic curves
+  * (SVG 1.1, appendix F.6 "Elliptical arc implementation notes")
+  *
+  * \param[in,out] path path
+  * \param[in] from current point
+  * \param[in] rx radius x
+  * \param[in] ry radius y
+  * \param[in] angle rotation of the ellipse in degrees
+  * \param[in] isLarge large arc flag
+  * \param[in] isSweep sweep flag
+  * \param[in] to end point
+  */
+void ParametricSvgPath::addArc(QPainterPath &path, const QPointF &from, double rx, double ry, double angle,
+                               bool isLarge, bool isSweep, const QPointF &to)
+{
+    if(from == to){
+        return;
+    }
+    rx = qAbs(rx);
+    ry = qAbs(ry);
+    if(qFuzzyIsNull(rx) || qFuzzyIsNull(ry)){
+        path.lineTo(to);
+        return;
+    }
+
+    const double phi = qDegreesToRadians(angle);
+    const double cosPhi = qCos(phi);
+    const double sinPhi = qSin(phi);
+    const double dx = (from.x() - to.x()) / 2;
+    const double dy = (from.y() - to.y()) / 2;
+    const double x1 = cosPhi * dx + sinPhi * dy;
+    const double y1 = -sinPhi * dx + cosPhi * dy;
+
+    //Радиусы увеличиваются, если дуга не помещается
+    const double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+    if(lambda > 1){
+        rx *= qSqrt(lambda);
+        ry *= qSqrt(lambda);
+    }
+
+    const double numerator = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+    const double denominator = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+    double coefficient = qSqrt(qMax(0.0, numerator / denominator));
+    if(isLarge == isSweep){
+        coefficient = -coefficient;
+    }
+    const double cx1 = coefficient * rx * y1 / ry;
+    const double cy1 = -coefficient * ry * x1 / rx;
+    const double cx = cosPhi * cx1 - sinPhi * cy1 + (from.x() + to.x()) / 2;
+    const double cy = sinPhi * cx1 + cosPhi * cy1 + (from.y() + to.y()) / 2;
+
+    const double theta = qAtan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+    double delta = qAtan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - theta;
+    if(isSweep && delta < 0){
+        delta += 2 * M_PI;
+    }else if(!isSweep && delta > 0){
+        delta -= 2 * M_PI;
+    }
+
+    //Не более четверти эллипса на одну кривую
+    const int segments = qMax(1, qCeil(qAbs(delta) / (M_PI / 2) - 1e-9));
+    const double step = delta / segments;
+    const double t = 4.0 / 3.0 * qTan(step / 4);
+    auto map = [&](double x, double y) {
+        return QPointF(cx + rx * x * cosPhi - ry * y * sinPhi,
+                       cy + rx * x * sinPhi + ry * y * cosPhi);
+    };
+    for (int i = 0; i < segments; ++i) {
+        const double a1 = theta + i * step;
+        const double a2 = a1 + step;
+        const double cos1 = qCos(a1);
+        const double sin1 = qSin(a1);
+        const double cos2 = qCos(a2);
+        const double sin2 = qSin(a2);
+        const QPointF end = i == segments - 1 ? to : map(cos2, sin2);
+        path.cubicTo(map(cos1 - t * sin1, sin1 + t * cos1),
+                     map(cos2 + t * sin2, sin2 - t * cos2),
+                     end);
+    }
+}
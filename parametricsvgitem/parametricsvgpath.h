@@ -0,0 +1,78 @@
+#ifndef PARAMETRICSVGPATH_H
+#define PARAMETRICSVGPATH_H
+
+
+#include <QHash>
+#include <QPainterPath>
+#include <QString>
+#include <QVector>
+#include "parametricexpression.h"
+
+class ParametricSvgPath
+{
+public:
+    ParametricSvgPath();
+
+    bool compile(const QString &source, const QHash<QString, int> &names);
+    bool parse(const QString &data);
+    bool isValid() const;
+    bool isCompiled() const;
+    int slotsCount() const;
+    bool evaluate(const QVector<ParametricExpression::Value> &environment, QString *error);
+
+    void setFillRule(Qt::FillRule fillRule);
+    const QPainterPath &path();
+
+private:
+    //Команда пути и номер её первого аргумента
+    struct Command {
+        char type;
+        int argument;
+    };
+
+    //Числовая ячейка: аргумент, вычисляемый подстановкой шаблона
+    struct Slot {
+        int argument;
+        ParametricExpression expression;
+    };
+
+    //Фрагмент исходного шаблона: текст или подстановка
+    struct Piece {
+        QString text;
+        bool isSlot;
+        ParametricExpression expression;
+    };
+
+    QVector<Command> m_commands;
+    QVector<double> m_arguments;
+    QVector<Slot> m_slots;
+    bool m_isValid;
+    bool m_isCompiled;
+    Qt::FillRule m_fillRule;
+    //Путь строится заново только после изменения аргументов
+    QPainterPath m_path;
+    bool m_isPathChanged;
+
+    //Состояние разбора
+    QVector<Piece> m_pieces;
+    int m_piece;
+    int m_position;
+
+
+    //методы
+    bool splitTemplate(const QString &source, const QHash<QString, int> &names);
+    bool parsePieces();
+    void skipSeparators();
+    bool isAtEnd();
+    bool hasArgument();
+    char readCommand();
+    bool readArgument(bool isFlag);
+    void buildPath();
+
+    static int argumentsCount(char command);
+    static bool isNumberChar(QChar c);
+    static void addArc(QPainterPath &path, const QPointF &from, double rx, double ry, double angle,
+                       bool isLarge, bool isSweep, const QPointF &to);
+};
+
+#endif // PARAMETRICSVGPATH_H
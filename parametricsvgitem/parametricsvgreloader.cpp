@@ -0,0 +1,154 @@
+/*!
+ * \class ParametricSvgReloader
+ * Watcher of template files reloading all items with a changed template
+ * in one pass. The template is parsed once and shared by the items.
+ */
+#include "parametricsvgreloader.h"
+#include "parametricsvgitem.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+
+ParametricSvgReloader::ParametricSvgReloader(QObject *parent):
+    QObject(parent)
+{
+    //Редакторы записывают файл в несколько приёмов
+    m_timer.setInterval(200);
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &ParametricSvgReloader::reloadPending);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &ParametricSvgReloader::fileChanged);
+}
+
+/*!
+  * Get the watcher shared by all items. It must be used from the GUI thread.
+  *
+  * \return watcher instance
+  */
+ParametricSvgReloader *ParametricSvgReloader::instance()
+{
+    static ParametricSvgReloader *reloader = new ParametricSvgReloader(QCoreApplication::instance());
+    return reloader;
+}
+
+/*!
+  * Reload the item, when the file of its template is changed
+  *
+  * \param[in] item item with loaded content
+  */
+void ParametricSvgReloader::watch(ParametricSvgItem *item)
+{
+    unwatch(item);
+    QSharedPointer<const ParametricSvgTemplate> svgTemplate = item->svgTemplate();
+    if(svgTemplate.isNull()){
+        return;
+    }
+
+    const QString path = svgTemplate->fileName();
+    QList<ParametricSvgItem *> &items = m_items[path];
+    items.append(item);
+    if(items.size() == 1){
+        m_watcher.addPath(path);
+    }
+}
+
+/*!
+  * Stop reloading the item
+  *
+  * \param[in] item watched item
+  */
+void ParametricSvgReloader::unwatch(ParametricSvgItem *item)
+{
+    QMutableHashIterator<QString, QList<ParametricSvgItem *> > i(m_items);
+    while (i.hasNext()) {
+        i.next();
+        if(i.value().removeAll(item) > 0 && i.value().isEmpty()){
+            m_watcher.removePath(i.key());
+            m_pendingFiles.remove(i.key());
+            i.remove();
+        }
+    }
+}
+
+/*!
+  * Get watched template files
+  *
+  * \return paths to files
+  */
+QStringList ParametricSvgReloader::files() const
+{
+    return m_items.keys();
+}
+
+/*!
+  * Set time from the last change of a file to reloading
+  *
+  * \param[in] msecs delay in milliseconds
+  */
+void ParametricSvgReloader::setDelay(int msecs)
+{
+    m_timer.setInterval(qMax(msecs, 0));
+}
+
+int ParametricSvgReloader::delay() const
+{
+    return m_timer.interval();
+}
+
+void ParametricSvgReloader::fileChanged(const QString &path)
+{
+    if(!m_items.contains(path)){
+        return;
+    }
+    m_pendingFiles.insert(path);
+    m_timer.start();
+}
+
+/*!
+  * Reload all items of the changed files
+  */
+void ParametricSvgReloader::reloadPending()
+{
+    const QSet<QString> files = m_pendingFiles;
+    m_pendingFiles.clear();
+
+    QSet<QString> missingFiles;
+    foreach (const QString &path, files) {
+        const QList<ParametricSvgItem *> items = m_items.value(path);
+        if(items.isEmpty()){
+            continue;
+        }
+        //Редактор мог удалить файл перед записью новой версии
+        if(!QFileInfo::exists(path)){
+            missingFiles.insert(path);
+            continue;
+        }
+        //Файл, заменённый при сохранении, перестаёт отслеживаться
+        if(!m_watcher.files().contains(path)){
+            m_watcher.addPath(path);
+        }
+
+        //Новый шаблон разбирается один раз и остаётся в кэше, пока элементы перезагружаются
+        QSharedPointer<const ParametricSvgTemplate> previous = items.first()->svgTemplate();
+        QSharedPointer<const ParametricSvgTemplate> current = ParametricSvgTemplate::load(path, previous->namespaceName());
+        if(current.isNull()){
+            emit reloadFailed(path);
+            continue;
+        }
+        if(current == previous){
+            continue;
+        }
+
+        foreach (ParametricSvgItem *item, items) {
+            //Элемент мог быть удалён обработчиком сигнала другого элемента
+            if(m_items.value(path).contains(item)){
+                item->reload();
+            }
+        }
+        emit reloaded(path, previous->changedDeclarations(*current));
+    }
+
+    //Удалённый файл больше не отслеживается, поэтому проверяется снова
+    if(!missingFiles.isEmpty()){
+        m_pendingFiles.unite(missingFiles);
+        m_timer.start();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef PARAMETRICSVGRELOADER_H
+#define PARAMETRICSVGRELOADER_H
+
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class ParametricSvgItem;
+
+class ParametricSvgReloader : public QObject
+{
+    Q_OBJECT
+private:
+    QFileSystemWatcher m_watcher;
+    //Файл шаблона -> элементы с этим шаблоном
+    QHash<QString, QList<ParametricSvgItem *> > m_items;
+    //Изменённые файлы, ожидающие окончания записи
+    QSet<QString> m_pendingFiles;
+    QTimer m_timer;
+
+    explicit ParametricSvgReloader(QObject *parent = nullptr);
+
+private slots:
+    void fileChanged(const QString &path);
+    void reloadPending();
+
+signals:
+    void reloaded(const QString &fileName, const QStringList &changedNames);
+    void reloadFailed(const QString &fileName);
+
+public:
+    static ParametricSvgReloader *instance();
+
+    void watch(ParametricSvgItem *item);
+    void unwatch(ParametricSvgItem *item);
+    QStringList files() const;
+
+    void setDelay(int msecs);
+    int delay() const;
+};
+
+#endif // PARAMETRICSVGRELOADER_H
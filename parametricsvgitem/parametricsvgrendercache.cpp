@@ -0,0 +1,175 @@
+/*!
+ * \class ParametricSvgRenderCache
+ * Process-wide LRU cache of loaded SVG renderers for identical parameter sets
+ */
+#include "parametricsvgrendercache.h"
+#include <QCoreApplication>
+#include <QPainter>
+#include <QSvgRenderer>
+
+ParametricSvgRenderCache::ParametricSvgRenderCache(QObject *parent):
+    QObject(parent)
+{
+    //64 Мб по умолчанию
+    m_entries.setMaxCost(64 * 1024);
+    //Растровые изображения нельзя удалять после завершения QGuiApplication
+    if(parent){
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                this, &ParametricSvgRenderCache::clear);
+    }
+}
+
+/*!
+  * Get the cache shared by all items
+  *
+  * \return cache instance
+  */
+ParametricSvgRenderCache *ParametricSvgRenderCache::instance()
+{
+    static ParametricSvgRenderCache *cache = new ParametricSvgRenderCache(QCoreApplication::instance());
+    return cache;
+}
+
+/*!
+  * Set size limit of the cache. Least recently used entries are evicted first.
+  * Items keep using evicted renderers until their next update.
+  *
+  * \param[in] kilobytes approximate memory limit
+  */
+void ParametricSvgRenderCache::setMaxCost(int kilobytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.setMaxCost(kilobytes);
+}
+
+int ParametricSvgRenderCache::maxCost() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.maxCost();
+}
+
+int ParametricSvgRenderCache::totalCost() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.totalCost();
+}
+
+/*!
+  * Find renderer loaded for the key
+  *
+  * \param[in] key template and parameter values
+  * \return shared renderer. A null pointer, if there is no such entry
+  */
+QSharedPointer<QSvgRenderer> ParametricSvgRenderCache::renderer(const QByteArray &key)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry *entry = m_entries.object(key);
+    if(!entry){
+        return QSharedPointer<QSvgRenderer>();
+    }
+    return entry->renderer;
+}
+
+/*!
+  * Load SVG data into a new renderer and add it to the cache
+  *
+  * \param[in] key template and parameter values
+  * \param[in] data evaluated SVG document
+  * \return shared renderer. It stays valid after eviction from the cache
+  */
+QSharedPointer<QSvgRenderer> ParametricSvgRenderCache::insert(const QByteArray &key, const QByteArray &data)
+{
+    QSharedPointer<QSvgRenderer> renderer(new QSvgRenderer(data));
+    insert(key, renderer, data.size());
+    return renderer;
+}
+
+/*!
+  * Add renderer loaded elsewhere, e.g. in a worker thread, to the cache.
+  * The renderer must belong to the thread that uses the cache entries.
+  *
+  * \param[in] key template and parameter values
+  * \param[in] renderer loaded renderer
+  * \param[in] dataSize size of the loaded SVG document
+  */
+void ParametricSvgRenderCache::insert(const QByteArray &key, const QSharedPointer<QSvgRenderer> &renderer, int dataSize)
+{
+    QMutexLocker locker(&m_mutex);
+    Entry *entry = new Entry;
+    entry->renderer = renderer;
+    entry->rendererCost = rendererCost(dataSize);
+    m_entries.insert(key, entry, entry->rendererCost);
+}
+
+/*!
+  * Get rasterized image of the cached renderer.
+  * The image is rendered again if the requested size differs from the cached one.
+  *
+  * \param[in] key template and parameter values
+  * \param[in] size size of the image in device pixels
+  * \return image. A null pixmap, if there is no such entry
+  */
+QPixmap ParametricSvgRenderCache::pixmap(const QByteArray &key, const QSize &size)
+{
+    QSharedPointer<QSvgRenderer> renderer;
+    int cost = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        Entry *entry = m_entries.object(key);
+        if(!entry || size.isEmpty()){
+            return QPixmap();
+        }
+        if(entry->pixmap.size() == size){
+            return entry->pixmap;
+        }
+        renderer = entry->renderer;
+        cost = entry->rendererCost;
+    }
+
+    //Отрисовка не блокирует других пользователей кэша
+    QPixmap pixmap(size);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    renderer->render(&painter, QRectF(QPointF(0.0, 0.0), QSizeF(size)));
+    painter.end();
+
+    QMutexLocker locker(&m_mutex);
+    //QCache удаляет запись, стоимость которой больше предела,
+    //поэтому слишком большое изображение не кэшируется
+    Entry *entry = m_entries.object(key);
+    if(!entry || entry->renderer != renderer || cost + pixmapCost(pixmap) > m_entries.maxCost()){
+        return pixmap;
+    }
+
+    //Запись заменяется, чтобы учесть размер изображения в стоимости
+    Entry *updated = new Entry;
+    updated->renderer = renderer;
+    updated->rendererCost = cost;
+    updated->pixmap = pixmap;
+    m_entries.insert(key, updated, updated->rendererCost + pixmapCost(pixmap));
+
+    return pixmap;
+}
+
+void ParametricSvgRenderCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+}
+
+/*!
+  * Estimate memory used by the renderer: the parsed document is
+  * assumed to be about the size of the SVG text
+  *
+  * \param[in] dataSize size of SVG document
+  * \return cost in kilobytes
+  */
+int ParametricSvgRenderCache::rendererCost(int dataSize)
+{
+    return 1 + dataSize / 1024;
+}
+
+int ParametricSvgRenderCache::pixmapCost(const QPixmap &pixmap)
+{
+    return pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024;
+}
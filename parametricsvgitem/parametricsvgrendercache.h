@@ -0,0 +1,50 @@
+#ifndef PARAMETRICSVGRENDERCACHE_H
+#define PARAMETRICSVGRENDERCACHE_H
+
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QSharedPointer>
+
+class QSvgRenderer;
+
+class ParametricSvgRenderCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    //Загруженный SVG и его растровое изображение
+    struct Entry {
+        QSharedPointer<QSvgRenderer> renderer;
+        int rendererCost;
+        QPixmap pixmap;
+    };
+
+    //Ключ: шаблон и значения параметров; стоимость записи в килобайтах
+    QCache<QByteArray, Entry> m_entries;
+    mutable QMutex m_mutex;
+
+    explicit ParametricSvgRenderCache(QObject *parent = nullptr);
+
+    static int rendererCost(int dataSize);
+    static int pixmapCost(const QPixmap &pixmap);
+
+public:
+    static ParametricSvgRenderCache *instance();
+
+    void setMaxCost(int kilobytes);
+    int maxCost() const;
+    int totalCost() const;
+
+    QSharedPointer<QSvgRenderer> renderer(const QByteArray &key);
+    QSharedPointer<QSvgRenderer> insert(const QByteArray &key, const QByteArray &data);
+    void insert(const QByteArray &key, const QSharedPointer<QSvgRenderer> &renderer, int dataSize);
+    QPixmap pixmap(const QByteArray &key, const QSize &size);
+
+    void clear();
+};
+
+#endif // PARAMETRICSVGRENDERCACHE_H
@@ -0,0 +1,109 @@
+/*!
+ * \class ParametricSvgTrace
+ * Process-wide recorder of evaluation phases in Chrome trace format
+ * (chrome://tracing, Perfetto). Phases are recorded only for documents
+ * and items with enabled statistics.
+ */
+#include "parametricsvgstats.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+ParametricSvgTrace::ParametricSvgTrace():
+    m_isEnabled(0)
+{
+}
+
+ParametricSvgTrace *ParametricSvgTrace::instance()
+{
+    static ParametricSvgTrace trace;
+    return &trace;
+}
+
+/*!
+  * Get monotonic time shared by all threads
+  *
+  * \return nanoseconds from the first call
+  */
+qint64 ParametricSvgTrace::now()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer started;
+        started.start();
+        return started;
+    }();
+    return timer.nsecsElapsed();
+}
+
+/*!
+  * Start or stop recording of events. Recorded events are kept.
+  *
+  * \param[in] isEnabled true to record
+  */
+void ParametricSvgTrace::setEnabled(bool isEnabled)
+{
+    m_isEnabled.storeRelease(isEnabled ? 1 : 0);
+}
+
+bool ParametricSvgTrace::isEnabled() const
+{
+    return m_isEnabled.loadAcquire() != 0;
+}
+
+/*!
+  * Record a completed phase
+  *
+  * \param[in] name static name of the phase
+  * \param[in] start start time from now()
+  * \param[in] duration duration in nanoseconds
+  */
+void ParametricSvgTrace::addEvent(const char *name, qint64 start, qint64 duration)
+{
+    if(!isEnabled()){
+        return;
+    }
+    Event event;
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    event.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QMutexLocker locker(&m_mutex);
+    m_events.append(event);
+}
+
+/*!
+  * Write recorded events as Chrome trace JSON
+  *
+  * \param[in] fname path to JSON file
+  * \return true on succes
+  */
+bool ParametricSvgTrace::save(const QString &fname)
+{
+    QFile file(fname);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QTextStream out(&file);
+    out << "{\"traceEvents\":[";
+    for (int i = 0; i < m_events.size(); ++i) {
+        const Event &event = m_events.at(i);
+        //Время в микросекундах
+        out << (i > 0 ? ",\n" : "\n")
+            << "{\"name\":\"" << event.name << "\",\"cat\":\"parametricsvg\",\"ph\":\"X\""
+            << ",\"ts\":" << QString::number(event.start / 1000.0, 'f', 3)
+            << ",\"dur\":" << QString::number(event.duration / 1000.0, 'f', 3)
+            << ",\"pid\":1,\"tid\":" << event.thread << "}";
+    }
+    out << "\n]}\n";
+    return out.status() == QTextStream::Ok;
+}
+
+void ParametricSvgTrace::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+}
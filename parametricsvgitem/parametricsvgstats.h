@@ -0,0 +1,86 @@
+#ifndef PARAMETRICSVGSTATS_H
+#define PARAMETRICSVGSTATS_H
+
+
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+//Время этапов (нс) и счётчики одного обновления
+struct ParametricSvgStats
+{
+    qint64 parametersTime = 0;
+    qint64 expressionsTime = 0;
+    qint64 bindingsTime = 0;
+    qint64 serializeTime = 0;
+    qint64 loadTime = 0;
+
+    int nativeEvaluations = 0;
+    int jsEvaluations = 0;
+    int attributesPatched = 0;
+    int bytesSerialized = 0;
+    int errors = 0;
+
+    void clear() {*this = ParametricSvgStats();}
+};
+
+Q_DECLARE_METATYPE(ParametricSvgStats)
+
+class ParametricSvgTrace
+{
+private:
+    //Событие формата Chrome trace
+    struct Event {
+        const char *name;
+        qint64 start;
+        qint64 duration;
+        quintptr thread;
+    };
+
+    QVector<Event> m_events;
+    QMutex m_mutex;
+    QAtomicInt m_isEnabled;
+
+    ParametricSvgTrace();
+
+public:
+    static ParametricSvgTrace *instance();
+    static qint64 now();
+
+    void setEnabled(bool isEnabled);
+    bool isEnabled() const;
+
+    void addEvent(const char *name, qint64 start, qint64 duration);
+    bool save(const QString &fname);
+    void clear();
+};
+
+//Замер этапа до конца области видимости; без счётчика ничего не делает
+class ParametricSvgPhase
+{
+private:
+    qint64 *m_time;
+    const char *m_name;
+    qint64 m_start;
+
+public:
+    ParametricSvgPhase(qint64 *time, const char *name):
+        m_time(time),
+        m_name(name),
+        m_start(time ? ParametricSvgTrace::now() : 0)
+    {
+    }
+
+    ~ParametricSvgPhase()
+    {
+        if(m_time){
+            qint64 duration = ParametricSvgTrace::now() - m_start;
+            *m_time += duration;
+            ParametricSvgTrace::instance()->addEvent(m_name, m_start, duration);
+        }
+    }
+};
+
+#endif // PARAMETRICSVGSTATS_H
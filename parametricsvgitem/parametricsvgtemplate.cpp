@@ -0,0 +1,1890 @@
+/*!
+ * \class ParametricSvgTemplate
+ * Immutable parsed parametric SVG shared between items loaded from the same file
+ */
+#include "parametricsvgtemplate.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJSEngine>
+#include <QAtomicInt>
+#include <QBuffer>
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QXmlStreamReader>
+#include <qmath.h>
+#include <algorithm>
+#include <limits>
+
+//Ключ графа зависимостей для выражений, зависящих от любого имени
+static const QLatin1String AnyName("*");
+
+//Маркер значения привязки из области частного использования Unicode
+static const QString MarkerBegin = QString(QChar(0xE000)) + QLatin1String("PSVG");
+static const QChar MarkerEnd(0xE001);
+
+//Скомпилированный шаблон: сигнатура "PSVT" и версия формата
+static const quint32 CompiledMagic = 0x50535654;
+static const quint16 CompiledVersion = 1;
+
+//Свойства оформления путей, которые рисуются без QSvgRenderer
+static bool isNativeProperty(const QString &name)
+{
+    static const QSet<QString> names = {
+        "fill", "fill-opacity", "fill-rule", "opacity",
+        "stroke", "stroke-opacity", "stroke-width",
+        "stroke-linecap", "stroke-linejoin", "stroke-miterlimit"
+    };
+    return names.contains(name);
+}
+
+//Цвет SVG: имя, #rgb, #rrggbb или rgb(r, g, b)
+static bool parseColor(const QString &value, QColor *color)
+{
+    if(value.startsWith(QLatin1String("rgb("), Qt::CaseInsensitive) && value.endsWith(QLatin1Char(')'))){
+        const QStringList parts = value.mid(4, value.size() - 5).split(QLatin1Char(','));
+        if(parts.size() != 3){
+            return false;
+        }
+        int channels[3];
+        for (int i = 0; i < 3; ++i) {
+            QString part = parts.at(i).trimmed();
+            const bool isPercent = part.endsWith(QLatin1Char('%'));
+            if(isPercent){
+                part.chop(1);
+            }
+            bool ok = false;
+            double channel = part.toDouble(&ok);
+            if(!ok){
+                return false;
+            }
+            channels[i] = qBound(0, qRound(isPercent ? channel * 255 / 100 : channel), 255);
+        }
+        *color = QColor(channels[0], channels[1], channels[2]);
+        return true;
+    }
+    //currentColor и ссылки на градиенты рисуются рендерером
+    if(!QColor::isValidColor(value)){
+        return false;
+    }
+    color->setNamedColor(value);
+    return true;
+}
+
+//Число с необязательной единицей px
+static bool parseLength(QString value, double *length)
+{
+    if(value.endsWith(QLatin1String("px"))){
+        value.chop(2);
+    }
+    bool ok = false;
+    *length = value.trimmed().toDouble(&ok);
+    return ok && *length >= 0;
+}
+
+//Список преобразований атрибута transform
+static bool parseTransform(const QString &value, QTransform *transform)
+{
+    QTransform result;
+    int position = 0;
+    while (true) {
+        while (position < value.size() && (value.at(position).isSpace() || value.at(position) == QLatin1Char(','))) {
+            ++position;
+        }
+        if(position >= value.size()){
+            break;
+        }
+        const int nameBegin = position;
+        while (position < value.size() && value.at(position).isLetter()) {
+            ++position;
+        }
+        const QString name = value.mid(nameBegin, position - nameBegin);
+        while (position < value.size() && value.at(position).isSpace()) {
+            ++position;
+        }
+        const int close = value.indexOf(QLatin1Char(')'), position);
+        if(position >= value.size() || value.at(position) != QLatin1Char('(') || close < 0){
+            return false;
+        }
+        QString arguments = value.mid(position + 1, close - position - 1);
+        const QStringList parts = arguments.replace(QLatin1Char(','), QLatin1Char(' ')).simplified()
+                .split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        QVector<qreal> a;
+        foreach (const QString &part, parts) {
+            bool ok = false;
+            a.append(part.toDouble(&ok));
+            if(!ok){
+                return false;
+            }
+        }
+        position = close + 1;
+
+        QTransform t;
+        if(name == "matrix" && a.size() == 6){
+            t = QTransform(a[0], a[1], a[2], a[3], a[4], a[5]);
+        }else if(name == "translate" && (a.size() == 1 || a.size() == 2)){
+            t = QTransform::fromTranslate(a[0], a.size() > 1 ? a[1] : 0.0);
+        }else if(name == "scale" && (a.size() == 1 || a.size() == 2)){
+            t = QTransform::fromScale(a[0], a.size() > 1 ? a[1] : a[0]);
+        }else if(name == "rotate" && (a.size() == 1 || a.size() == 3)){
+            if(a.size() == 3){
+                t.translate(a[1], a[2]);
+            }
+            t.rotate(a[0]);
+            if(a.size() == 3){
+                t.translate(-a[1], -a[2]);
+            }
+        }else if(name == "skewX" && a.size() == 1){
+            t = QTransform(1, 0, qTan(qDegreesToRadians(a[0])), 1, 0, 0);
+        }else if(name == "skewY" && a.size() == 1){
+            t = QTransform(1, qTan(qDegreesToRadians(a[0])), 0, 1, 0, 0);
+        }else{
+            return false;
+        }
+        //Правое преобразование списка применяется первым
+        result = t * result;
+    }
+    *transform = result;
+    return true;
+}
+
+ParametricSvgTemplate::ParametricSvgTemplate(const QString &fname, const QString &namespaceName):
+    m_id(0),
+    m_fileName(fname),
+    m_sourceSize(-1),
+    m_namespace(namespaceName),
+    m_renderSize(0)
+{
+    static QAtomicInt lastId;
+    m_id = lastId.fetchAndAddRelaxed(1) + 1;
+}
+
+ParametricSvgTemplate::~ParametricSvgTemplate()
+{
+}
+
+/*!
+  * Get template from the cache or load it from SVG file.
+  * Template is reloaded, if the file was modified after the last load.
+  * Unused templates are released together with the last item.
+  *
+  * \param[in] fname Full path to SVG file
+  * \param[in] namespaceName namespace prefix of parametric attributes
+  * \return shared template. A null pointer on error
+  */
+QSharedPointer<const ParametricSvgTemplate> ParametricSvgTemplate::load(const QString &fname, const QString &namespaceName)
+{
+    if(fname.isEmpty()){
+        return QSharedPointer<const ParametricSvgTemplate>();
+    }
+
+    QFileInfo info(fname);
+    const QString path = info.canonicalFilePath();
+    if(path.isEmpty()){
+        return QSharedPointer<const ParametricSvgTemplate>();
+    }
+    const QString key = namespaceName + QLatin1Char('|') + path;
+
+    //Разбор выполняется без блокировки, чтобы не задерживать загрузку других файлов
+    static QMutex mutex;
+    {
+        QMutexLocker locker(&mutex);
+        QSharedPointer<const ParametricSvgTemplate> cached = cachedTemplate(key, info);
+        if(!cached.isNull()){
+            return cached;
+        }
+    }
+
+    QSharedPointer<ParametricSvgTemplate> svgTemplate(new ParametricSvgTemplate(path, namespaceName));
+    if(!svgTemplate->setContent()){
+        return QSharedPointer<const ParametricSvgTemplate>();
+    }
+
+    QMutexLocker locker(&mutex);
+    //Другой поток мог загрузить тот же файл, пока шёл разбор
+    QSharedPointer<const ParametricSvgTemplate> cached = cachedTemplate(key, info);
+    if(!cached.isNull()){
+        return cached;
+    }
+
+    //Удалить записи шаблонов, которые уже никем не используются
+    QHash<QString, CacheEntry> &entries = cache();
+    QMutableHashIterator<QString, CacheEntry> j(entries);
+    while (j.hasNext()) {
+        j.next();
+        if(j.value().svgTemplate.isNull()){
+            j.remove();
+        }
+    }
+
+    CacheEntry entry;
+    entry.modified = svgTemplate->m_sourceModified;
+    entry.size = svgTemplate->m_sourceSize;
+    entry.svgTemplate = svgTemplate;
+    entries.insert(key, entry);
+
+    return svgTemplate;
+}
+
+/*!
+  * Find template in the cache. The cache must be locked by the caller.
+  *
+  * \param[in] key namespace and canonical path
+  * \param[in] info file information to detect modified files
+  * \return shared template. A null pointer, if it is not loaded or stale
+  */
+QSharedPointer<const ParametricSvgTemplate> ParametricSvgTemplate::cachedTemplate(const QString &key, const QFileInfo &info)
+{
+    const QHash<QString, CacheEntry> &entries = cache();
+    QHash<QString, CacheEntry>::const_iterator i = entries.constFind(key);
+    if(i != entries.constEnd()
+            && i.value().modified == info.lastModified()
+            && i.value().size == info.size()){
+        return i.value().svgTemplate.toStrongRef();
+    }
+    return QSharedPointer<const ParametricSvgTemplate>();
+}
+
+QHash<QString, ParametricSvgTemplate::CacheEntry> &ParametricSvgTemplate::cache()
+{
+    static QHash<QString, CacheEntry> entries;
+    return entries;
+}
+
+/*!
+  * Parse SVG file: parameters, expressions, bindings, dependencies and static fragments
+  *
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::setContent()
+{
+    //Метка снимается до чтения: если файл изменится во время разбора,
+    //он будет разобран снова при следующей загрузке
+    QFileInfo info(m_fileName);
+    m_sourceSize = info.size();
+    m_sourceModified = info.lastModified();
+
+    //DOM нужен только для файлов, которые нельзя разобрать потоково
+    if(!readCompiled() && !readStream() && !readDom()){
+        return false;
+    }
+
+    buildNameTable();
+    classifySources();
+    buildDependencyGraph();
+
+    return true;
+}
+
+/*!
+  * Get name of the compiled template for SVG file
+  *
+  * \param[in] fname path to SVG file
+  * \return path to the file with .psvgc extension in the same directory
+  */
+QString ParametricSvgTemplate::compiledFileName(const QString &fname)
+{
+    QFileInfo info(fname);
+    return info.dir().filePath(info.completeBaseName() + ".psvgc");
+}
+
+/*!
+  * Save parsed template into binary file, which is loaded instead of SVG
+  * until the SVG file is modified. Size and time of modification of SVG
+  * file at the time of parsing are stored to detect stale files.
+  *
+  * \param[in] fname path to the compiled template
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::saveCompiled(const QString &fname) const
+{
+    if(m_sourceSize < 0){
+        return false;
+    }
+
+    QSaveFile file(fname);
+    if(!file.open(QIODevice::WriteOnly)){
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << CompiledMagic << CompiledVersion;
+    stream << m_namespace << m_sourceSize << m_sourceModified.toMSecsSinceEpoch();
+
+    stream << quint32(m_parameters.size());
+    foreach (const Parameter &param, m_parameters) {
+        stream << param.name << param.value << double(param.min) << double(param.max);
+    }
+    stream << quint32(m_expressions.size());
+    foreach (const Expression &exp, m_expressions) {
+        stream << exp.name << exp.value;
+    }
+    stream << quint32(m_bindings.size());
+    foreach (const Binding &binding, m_bindings) {
+        stream << binding.source << binding.value;
+    }
+
+    //Фрагменты записываются одним блоком и таблицей смещений
+    QByteArray source;
+    source.reserve(m_renderSize);
+    stream << quint32(m_renderSegments.size());
+    foreach (const RenderSegment &segment, m_renderSegments) {
+        stream << qint32(source.size()) << qint32(segment.data.size()) << qint32(segment.binding);
+        source.append(segment.data);
+    }
+    stream << source;
+
+    if(stream.status() != QDataStream::Ok){
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/*!
+  * Load template compiled by saveCompiled() without parsing XML.
+  * The file stays mapped and static fragments point into it.
+  *
+  * \return false, if there is no compiled template, it is stale
+  * or has another version of the format
+  */
+bool ParametricSvgTemplate::readCompiled()
+{
+    m_compiledFile.setFileName(compiledFileName(m_fileName));
+    if(!m_compiledFile.open(QIODevice::ReadOnly)){
+        return false;
+    }
+    const qint64 size = m_compiledFile.size();
+    if(size <= 0 || size > std::numeric_limits<int>::max()){
+        m_compiledFile.close();
+        return false;
+    }
+    uchar *mapped = m_compiledFile.map(0, size);
+    if(!mapped){
+        m_compiledFile.close();
+        return false;
+    }
+
+    //Данные читаются из отображения; фрагменты ссылаются на него без копирования
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), static_cast<int>(size));
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    QString namespaceName;
+    qint64 sourceSize = 0;
+    qint64 sourceModified = 0;
+    stream >> magic >> version;
+    if(magic != CompiledMagic || version != CompiledVersion){
+        m_compiledFile.close();
+        return false;
+    }
+    stream >> namespaceName >> sourceSize >> sourceModified;
+
+    if(namespaceName != m_namespace
+            || sourceSize != m_sourceSize
+            || sourceModified != m_sourceModified.toMSecsSinceEpoch()){
+        m_compiledFile.close();
+        return false;
+    }
+
+    quint32 count = 0;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Parameter param;
+        double min;
+        double max;
+        stream >> param.name >> param.value >> min >> max;
+        param.min = min;
+        param.max = max;
+        addParameter(param.name, param);
+    }
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        QString value;
+        stream >> name >> value;
+        addExpression(makeExpression(name, value));
+    }
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Binding binding;
+        stream >> binding.source >> binding.value;
+        m_bindings.append(binding);
+    }
+
+    struct Span {
+        qint32 offset;
+        qint32 length;
+        qint32 binding;
+    };
+    QVector<Span> spans;
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Span span;
+        stream >> span.offset >> span.length >> span.binding;
+        spans.append(span);
+    }
+    //Блок записан как QByteArray: длина, затем байты
+    quint32 sourceLength = 0;
+    stream >> sourceLength;
+    if(sourceLength == 0xFFFFFFFF){
+        sourceLength = 0;
+    }
+    const qint64 sourceOffset = buffer.pos();
+
+    bool isOk = stream.status() == QDataStream::Ok && !spans.isEmpty()
+            && sourceLength <= size - sourceOffset;
+    if(isOk){
+        m_source = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped) + sourceOffset, static_cast<int>(sourceLength));
+    }
+    foreach (const Span &span, spans) {
+        //Сумма смещения и длины из повреждённого файла может переполниться
+        isOk = isOk && span.offset >= 0 && span.length >= 0
+                && span.offset <= m_source.size()
+                && span.length <= m_source.size() - span.offset
+                && span.binding >= -1 && span.binding < m_bindings.size();
+    }
+    if(!isOk){
+        m_parameters.clear();
+        m_expressions.clear();
+        m_bindings.clear();
+        m_source.clear();
+        m_compiledFile.close();
+        return false;
+    }
+
+    m_renderSegments.clear();
+    m_renderSize = 0;
+    foreach (const Span &span, spans) {
+        RenderSegment segment;
+        segment.data = QByteArray::fromRawData(m_source.constData() + span.offset, span.length);
+        segment.binding = span.binding;
+        m_renderSegments.append(segment);
+        m_renderSize += span.length;
+    }
+    return true;
+}
+
+/*!
+  * Parse SVG file into QDomDocument and serialize it into static fragments
+  *
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::readDom()
+{
+    bool isOk = readXmlFromFile(m_fileName);
+    if(!isOk){
+        return false;
+    }
+
+    QDomElement docElem = m_xmlDoc.documentElement();
+    if(docElem.isNull()){
+        return false;
+    }
+
+    QDomNode defsNode = docElem.firstChildElement("defs");
+
+    isOk = readParameters(defsNode);
+    if(!isOk){
+        return false;
+    }
+
+    //Выражения JS
+    isOk = readExpressions(defsNode);
+    if(!isOk){
+        return false;
+    }
+
+    QVector<QDomNode> targets;
+    collectBindings(docElem, targets);
+
+    //Документ сериализуется один раз, дальше используются только фрагменты
+    buildRenderTemplate(targets);
+    m_xmlDoc.clear();
+
+    return true;
+}
+
+/*!
+  * Parse memory-mapped UTF-8 SVG file in one pass without building a DOM tree.
+  * Static content is kept as spans of the original file between parametric sites.
+  *
+  * \return false, if the file must be parsed by readDom(): the file is not UTF-8,
+  * has a DTD with entities, or can not be parsed
+  */
+bool ParametricSvgTemplate::readStream()
+{
+    QFile file(m_fileName);
+    if(!file.open(QIODevice::ReadOnly)){
+        return false;
+    }
+    const qint64 size = file.size();
+    if(size <= 0 || size > std::numeric_limits<int>::max()){
+        return false;
+    }
+    uchar *mapped = file.map(0, size);
+    if(!mapped){
+        return false;
+    }
+
+    //Данные не копируются, пока файл не разобран
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), static_cast<int>(size));
+    QVector<Site> sites;
+    bool isOk = scanStream(data, sites);
+    if(isOk){
+        m_source = QByteArray(data.constData(), data.size());
+    }
+    file.unmap(mapped);
+
+    if(!isOk){
+        m_parameters.clear();
+        m_expressions.clear();
+        m_bindings.clear();
+        return false;
+    }
+
+    //Фрагменты ссылаются на копию файла, которой владеет шаблон
+    m_renderSegments.clear();
+    int position = 0;
+    foreach (const Site &site, sites) {
+        RenderSegment segment;
+        segment.data = QByteArray::fromRawData(m_source.constData() + position, site.begin - position);
+        segment.binding = site.binding;
+        m_renderSegments.append(segment);
+        position = site.end;
+    }
+    RenderSegment tail;
+    tail.data = QByteArray::fromRawData(m_source.constData() + position, m_source.size() - position);
+    tail.binding = -1;
+    m_renderSegments.append(tail);
+
+    m_renderSize = 0;
+    for (int i = 0; i < m_renderSegments.size(); ++i) {
+        m_renderSize += m_renderSegments.at(i).data.size();
+    }
+    return true;
+}
+
+/*!
+  * Read declarations and parametric sites with QXmlStreamReader
+  *
+  * \param[in] data content of UTF-8 file
+  * \param[out] sites byte spans replaced by values of bindings, in document order
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::scanStream(const QByteArray &data, QVector<Site> &sites)
+{
+    //Смещения считаются в байтах UTF-8; UTF-16 разбирается через DOM
+    if(data.startsWith("\xFE\xFF") || data.startsWith("\xFF\xFE")){
+        return false;
+    }
+    Utf8Offsets offsets(data, data.startsWith("\xEF\xBB\xBF") ? 3 : 0);
+
+    const QString defaultName = m_namespace + ":default";
+    const QString expressionName = m_namespace + ":expression";
+
+    //Чтение блоками через устройство: разборщик не копирует весь файл в свой буфер
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QXmlStreamReader xml(&buffer);
+    int depth = 0;
+    int defsDepth = -1;
+    bool isDefsFound = false;
+    //Привязки к тексту элемента, ожидающие следующего токена
+    QVector<int> textBindings;
+
+    while (!xml.atEnd()) {
+        const int begin = offsets.toByte(xml.characterOffset());
+        const QXmlStreamReader::TokenType token = xml.readNext();
+        const int end = offsets.toByte(xml.characterOffset());
+
+        if(!textBindings.isEmpty()){
+            //Пробельный текст DOM отбрасывает, подставлять некуда
+            if(token == QXmlStreamReader::Characters && !xml.isWhitespace()){
+                if(end >= data.size() || data.at(end) != '<'){
+                    return false;
+                }
+                foreach (int index, textBindings) {
+                    m_bindings[index].value = xml.text().toString();
+                }
+                //Как и в DOM, подставляется последняя привязка
+                sites.append(Site{begin, end, textBindings.last()});
+            }
+            textBindings.clear();
+        }
+
+        switch (token) {
+        case QXmlStreamReader::StartDocument: {
+            const QString encoding = xml.documentEncoding().toString();
+            if(!encoding.isEmpty() && encoding.compare("utf-8", Qt::CaseInsensitive) != 0){
+                return false;
+            }
+            break;
+        }
+        case QXmlStreamReader::DTD:
+        case QXmlStreamReader::EntityReference:
+        case QXmlStreamReader::Invalid:
+            return false;
+
+        case QXmlStreamReader::StartElement: {
+            ++depth;
+            const QString qName = xml.qualifiedName().toString();
+            const int firstSite = sites.size();
+            const QXmlStreamAttributes attributes = xml.attributes();
+
+            if(depth == 2 && !isDefsFound && qName == "defs"){
+                isDefsFound = true;
+                defsDepth = depth;
+            }
+            if(defsDepth > 0 && depth > defsDepth){
+                if(qName == defaultName){
+                    Parameter param = makeParameter(attributes.value("param").toString(),
+                                                    attributes.value("value").toString(),
+                                                    attributes.value("min").toString(),
+                                                    attributes.value("max").toString());
+                    if(!param.name.isEmpty()){
+                        addParameter(param.name, param);
+                    }
+                }else if(qName == expressionName){
+                    QString value = attributes.value("exp").toString();
+                    if(value.isEmpty()){
+                        //Текст элемента, в том числе CDATA
+                        value = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                        --depth;
+                    }
+                    addExpression(makeExpression(attributes.value("var").toString(), value));
+                    break;
+                }
+            }
+
+            //Атрибуты корневого элемента не обрабатываются, как и в DOM
+            if(depth < 2){
+                break;
+            }
+            if(begin >= end || data.at(begin) != '<' || data.at(end - 1) != '>'){
+                return false;
+            }
+            foreach (const QXmlStreamAttribute &attribute, attributes) {
+                const QString attributeName = attribute.qualifiedName().toString();
+                if(!attributeName.startsWith(m_namespace)){
+                    continue;
+                }
+
+                Binding binding;
+                binding.source = attribute.value().toString();
+
+                const QString attName = getLocalName(attributeName);
+                if(attName.toLower() == "text"){
+                    textBindings.append(m_bindings.size());
+                }else{
+                    int valueBegin;
+                    int valueEnd;
+                    if(findAttributeValue(data, begin, end, attName.toUtf8(), &valueBegin, &valueEnd)){
+                        binding.value = attributes.value(attName).toString();
+                        sites.append(Site{valueBegin, valueEnd, m_bindings.size()});
+                    }
+                }
+                m_bindings.append(binding);
+            }
+            //Места подстановки внутри тега идут в порядке атрибутов
+            std::sort(sites.begin() + firstSite, sites.end(),
+                      [](const Site &a, const Site &b) { return a.begin < b.begin; });
+            break;
+        }
+        case QXmlStreamReader::EndElement:
+            if(depth == defsDepth){
+                defsDepth = -1;
+            }
+            --depth;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return !xml.hasError() && isDefsFound;
+}
+
+/*!
+  * Find value of attribute in the original text of a start tag
+  *
+  * \param[in] data content of the file
+  * \param[in] begin offset of '<'
+  * \param[in] end offset after '>'
+  * \param[in] name qualified name of attribute
+  * \param[out] valueBegin offset of the value after the quote
+  * \param[out] valueEnd offset of the closing quote
+  * \return true, if the attribute was found
+  */
+bool ParametricSvgTemplate::findAttributeValue(const QByteArray &data, int begin, int end, const QByteArray &name,
+                                               int *valueBegin, int *valueEnd)
+{
+    const char *text = data.constData();
+    int i = begin + 1;
+    //Имя элемента
+    while (i < end && !isXmlSpace(text[i]) && text[i] != '>' && text[i] != '/') {
+        ++i;
+    }
+
+    while (i < end) {
+        while (i < end && isXmlSpace(text[i])) {
+            ++i;
+        }
+        if(i >= end || text[i] == '>' || text[i] == '/'){
+            return false;
+        }
+
+        const int nameBegin = i;
+        while (i < end && !isXmlSpace(text[i]) && text[i] != '=') {
+            ++i;
+        }
+        const int nameEnd = i;
+        while (i < end && isXmlSpace(text[i])) {
+            ++i;
+        }
+        if(i >= end || text[i] != '='){
+            return false;
+        }
+        ++i;
+        while (i < end && isXmlSpace(text[i])) {
+            ++i;
+        }
+        if(i >= end || (text[i] != '"' && text[i] != '\'')){
+            return false;
+        }
+        const char quote = text[i];
+        const int attributeBegin = ++i;
+        while (i < end && text[i] != quote) {
+            ++i;
+        }
+        const int attributeEnd = i;
+        ++i;
+
+        if(nameEnd - nameBegin == name.size() && qstrncmp(text + nameBegin, name.constData(), name.size()) == 0){
+            *valueBegin = attributeBegin;
+            *valueEnd = attributeEnd;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParametricSvgTemplate::isXmlSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+ParametricSvgTemplate::Utf8Offsets::Utf8Offsets(const QByteArray &data, int byte):
+    m_data(data),
+    m_character(0),
+    m_byte(byte)
+{
+}
+
+/*!
+  * Convert offset of QXmlStreamReader in UTF-16 characters into bytes of UTF-8.
+  * Offsets must not decrease between calls.
+  *
+  * \param[in] character offset in characters
+  * \return offset in bytes
+  */
+int ParametricSvgTemplate::Utf8Offsets::toByte(qint64 character)
+{
+    const int size = m_data.size();
+    while (m_character < character && m_byte < size) {
+        const uchar c = static_cast<uchar>(m_data.at(m_byte));
+        int length = 1;
+        if(c >= 0xF0){
+            length = 4;
+        }else if(c >= 0xE0){
+            length = 3;
+        }else if(c >= 0xC0){
+            length = 2;
+        }
+        //Символ вне BMP занимает два символа UTF-16
+        m_character += length == 4 ? 2 : 1;
+        m_byte += length;
+    }
+    return qMin(m_byte, size);
+}
+
+/*!
+  * Get number of the template. Unlike the address it is never reused
+  * by another template loaded later.
+  *
+  * \return unique number
+  */
+int ParametricSvgTemplate::id() const
+{
+    return m_id;
+}
+
+QString ParametricSvgTemplate::fileName() const
+{
+    return m_fileName;
+}
+
+QString ParametricSvgTemplate::namespaceName() const
+{
+    return m_namespace;
+}
+
+const QMap<QString, ParametricSvgTemplate::Parameter> &ParametricSvgTemplate::parameters() const
+{
+    return m_parameters;
+}
+
+/*!
+  * Get names of all parameters and expressions.
+  * Index of the name is the index of its value in the evaluation environment.
+  *
+  * \return list of names
+  */
+const QStringList &ParametricSvgTemplate::names() const
+{
+    return m_names;
+}
+
+const QHash<QString, int> &ParametricSvgTemplate::nameIndex() const
+{
+    return m_nameIndex;
+}
+
+const QList<ParametricSvgTemplate::Expression> &ParametricSvgTemplate::expressions() const
+{
+    return m_expressions;
+}
+
+const QVector<ParametricSvgTemplate::Binding> &ParametricSvgTemplate::bindings() const
+{
+    return m_bindings;
+}
+
+const QVector<ParametricSvgTemplate::RenderSegment> &ParametricSvgTemplate::renderSegments() const
+{
+    return m_renderSegments;
+}
+
+/*!
+  * Get size of all static fragments
+  *
+  * \return size in bytes
+  */
+int ParametricSvgTemplate::renderSize() const
+{
+    return m_renderSize;
+}
+
+/*!
+  * Load content from SVG file
+  *
+  * \param[in] fname Full path to SVG file
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::readXmlFromFile(const QString &fname)
+{
+    if(fname.isEmpty()){
+        return false;
+    }
+
+    QFile file(fname);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    if (!m_xmlDoc.setContent(&file)) {
+        file.close();
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+/*!
+  * Read parameters from SVG and create it
+  *
+  * \param[in] node XML node with parameters declaration
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::readParameters(const QDomNode &node)
+{
+    if(node.isNull()){
+        return false;
+    }
+
+    QDomNodeList list = node.toElement().elementsByTagName(m_namespace + ":default");
+    for(int i=0; i<list.size(); ++i){
+        Parameter param = domNodeToParameter(list.at(i));
+
+        if (!param.name.isEmpty()) {
+            addParameter(param.name, param);
+        }
+    }
+    return true;
+}
+
+/*!
+  * Add variable parameter to parameters list
+  *
+  * \param[in] pName parameter name
+  * \param[in] param parameter data
+  */
+void ParametricSvgTemplate::addParameter(const QString &pName, const Parameter &param)
+{
+    if(pName.isEmpty()){
+        return;
+    }
+    if(!param.value.isValid() || param.value.isNull()){
+        return;
+    }
+    m_parameters[pName] = param;
+}
+
+/*!
+  * Convert XML QDomNode to Parameter
+  *
+  * \param[in] node XML node
+  * \return Parameter. An empty Parameter on error
+  */
+ParametricSvgTemplate::Parameter ParametricSvgTemplate::domNodeToParameter(const QDomNode &node)
+{
+    if(node.isNull() || !node.isElement()){
+        return Parameter();
+    }
+
+    const QDomElement element = node.toElement();
+    return makeParameter(element.attribute("param"), element.attribute("value"),
+                         element.attribute("min"), element.attribute("max"));
+}
+
+/*!
+  * Make Parameter from attributes of declaration
+  *
+  * \param[in] nameParam name of parameter
+  * \param[in] valueParam default value
+  * \param[in] minParam min limit
+  * \param[in] maxParam max limit
+  * \return Parameter. An empty Parameter on error
+  */
+ParametricSvgTemplate::Parameter ParametricSvgTemplate::makeParameter(const QString &nameParam, const QString &valueParam,
+                                                                      const QString &minParam, const QString &maxParam)
+{
+    Parameter result;
+    bool ok;
+
+    //Name
+    if(nameParam.isEmpty()){
+        return Parameter();
+    }
+    result.name = nameParam;
+
+    //Value
+    if(valueParam.isEmpty()){
+        return Parameter();
+    }
+    double value = valueParam.toDouble(&ok);
+    if(ok){
+        result.value = QVariant(value);
+    }else{
+        result.value = QVariant(valueParam);
+    }
+
+    //Min limit
+    double min = minParam.toDouble(&ok);
+    if(ok){
+        result.min = min;
+    }else{
+        result.min = -99999.0;
+    }
+
+    //Max limit
+    double max = maxParam.toDouble(&ok);
+    if(ok){
+        result.max = max;
+    }else{
+        result.max = 99999.0;
+    }
+
+    return result;
+}
+
+/*!
+  * Read expressions from SVG and add it to expression list
+  *
+  * \param[in] node XML node with parameters declaration
+  * \return true on succes
+  */
+bool ParametricSvgTemplate::readExpressions(const QDomNode &node)
+{
+    if(node.isNull()){
+        return false;
+    }
+
+    QDomNodeList exps = node.toElement().elementsByTagName(m_namespace + ":expression");
+    for(int i=0; i<exps.size(); ++i){
+        Expression exp = domNodeToExpression(exps.at(i));
+        addExpression(exp);
+    }
+
+    return true;
+}
+
+/*!
+  * Convert XML QDomNode to Expression
+  *
+  * \param[in] node XML node
+  * \return Expression. An empty Expression on error
+  */
+ParametricSvgTemplate::Expression ParametricSvgTemplate::domNodeToExpression(const QDomNode &node)
+{
+    if(node.isNull() || !node.isElement()){
+        return Expression();
+    }
+
+    QString variableValue = node.toElement().attribute("exp");
+    if(variableValue.isEmpty()){
+        //If the 'exp' attribute is empty,
+        //then the value is read from the node text (CDATA is acceptable).
+        variableValue = node.toElement().text();
+    }
+    return makeExpression(node.toElement().attribute("var"), variableValue);
+}
+
+/*!
+  * Make Expression from declaration
+  *
+  * \param[in] variableName name of variable
+  * \param[in] variableValue JavaScript source
+  * \return Expression. An empty Expression on error
+  */
+ParametricSvgTemplate::Expression ParametricSvgTemplate::makeExpression(const QString &variableName, const QString &variableValue)
+{
+    if(variableName.isEmpty() || variableValue.isEmpty()){
+        return Expression();
+    }
+    Expression exp;
+    exp.name = variableName;
+    exp.value = variableValue;
+
+    return exp;
+}
+
+/*!
+  * Add Expression to list
+  *
+  * \param[in] exp Expresion
+  */
+void ParametricSvgTemplate::addExpression(const ParametricSvgTemplate::Expression &exp)
+{
+    if(exp.name.isEmpty())
+        return;
+    m_expressions.append(exp);
+}
+
+/*!
+  * Compile JavaScript source into a callable function returning its value
+  *
+  * \param[in] jsEngine link to JavaScript Engine
+  * \param[in] source JavaScript expression
+  * \return compiled function. An undefined QJSValue if the source
+  * is not a single expression (e.g. a script with statements)
+  */
+QJSValue ParametricSvgTemplate::compileSource(QJSEngine *jsEngine, const QString &source)
+{
+    QString body = source.trimmed();
+    while (body.endsWith(QLatin1Char(';'))) {
+        body.chop(1);
+    }
+    if(body.isEmpty()){
+        return QJSValue();
+    }
+
+    QJSValue function = jsEngine->evaluate(
+                QStringLiteral("(function() { return (") + body + QStringLiteral("\n); })"));
+    if(function.isError() || !function.isCallable()){
+        return QJSValue();
+    }
+    return function;
+}
+
+/*!
+  * Build table of names: parameters first, then expressions.
+  * An expression with the name of a parameter writes the parameter value.
+  */
+void ParametricSvgTemplate::buildNameTable()
+{
+    m_names = m_parameters.keys();
+    m_nameIndex.clear();
+    for (int i = 0; i < m_names.size(); ++i) {
+        m_nameIndex.insert(m_names.at(i), i);
+    }
+
+    for (int i = 0; i < m_expressions.size(); ++i) {
+        Expression &exp = m_expressions[i];
+        if(!m_nameIndex.contains(exp.name)){
+            m_nameIndex.insert(exp.name, m_names.size());
+            m_names.append(exp.name);
+        }
+        exp.nameIndex = m_nameIndex.value(exp.name);
+    }
+}
+
+/*!
+  * Compile sources with the native evaluator. Sources outside its subset
+  * are checked by JavaScript engine: the ones, which are not a single expression
+  * and can not be compiled into a function, are evaluated as scripts
+  * and may change any variable.
+  */
+void ParametricSvgTemplate::classifySources()
+{
+    //Движок JS создаётся, только если есть выражения вне подмножества
+    QScopedPointer<QJSEngine> jsEngine;
+
+    for (int i = 0; i < m_expressions.size(); ++i) {
+        Expression &exp = m_expressions[i];
+        if(exp.native.compile(exp.value, m_nameIndex)){
+            continue;
+        }
+        if(jsEngine.isNull()){
+            jsEngine.reset(new QJSEngine());
+        }
+        exp.isDynamic = !compileSource(jsEngine.data(), exp.value).isCallable();
+    }
+
+    //Одинаковые шаблоны атрибутов компилируются один раз
+    QHash<QString, int> compiled;
+    for (int i = 0; i < m_bindings.size(); ++i) {
+        Binding &binding = m_bindings[i];
+        QHash<QString, int>::const_iterator j = compiled.constFind(binding.source);
+        if(j != compiled.constEnd()){
+            binding.native = m_bindings.at(j.value()).native;
+            binding.isDynamic = m_bindings.at(j.value()).isDynamic;
+            continue;
+        }
+        compiled.insert(binding.source, i);
+
+        if(binding.native.compile(binding.source, m_nameIndex)){
+            continue;
+        }
+        if(jsEngine.isNull()){
+            jsEngine.reset(new QJSEngine());
+        }
+        binding.isDynamic = !compileSource(jsEngine.data(), binding.source).isCallable();
+    }
+}
+
+/*!
+  * Build dependency graph of expressions and bindings
+  */
+void ParametricSvgTemplate::buildDependencyGraph()
+{
+    m_expressionReaders.clear();
+    for (int i = 0; i < m_expressions.size(); ++i) {
+        addReaders(m_expressionReaders, m_expressions.at(i).value, i, m_expressions.at(i).isDynamic);
+    }
+
+    m_bindingReaders.clear();
+    for (int i = 0; i < m_bindings.size(); ++i) {
+        addReaders(m_bindingReaders, m_bindings.at(i).source, i, m_bindings.at(i).isDynamic);
+    }
+}
+
+/*!
+  * Traverse all SVG nodes once and fill the binding table with parametric attributes
+  *
+  * \param[in] node link to parent XML node
+  * \param[out] targets nodes patched by bindings: attributes or text nodes
+  */
+void ParametricSvgTemplate::collectBindings(const QDomNode &node, QVector<QDomNode> &targets)
+{
+    QDomNode domNode = node.firstChild();
+
+    while (!(domNode.isNull())) {
+        if (domNodeIsValid(domNode)) {
+            QDomNamedNodeMap attributesMap = domNode.attributes();
+            for(int i=0; i<attributesMap.count(); ++i){
+                QDomNode attribut = attributesMap.item(i);
+                if(!attribut.nodeName().startsWith(m_namespace)){
+                    continue;
+                }
+
+                Binding binding;
+                binding.source = attribut.nodeValue();
+
+                QString attName = getLocalName(attribut.nodeName());
+                if (attName.toLower() == "text") {
+                    targets.append(domNode.firstChild());
+                }else {
+                    targets.append(domNode.toElement().attributeNode(attName));
+                }
+                m_bindings.append(binding);
+            }
+        }
+
+        collectBindings(domNode, targets);
+        domNode = domNode.nextSibling();
+    }
+}
+
+/*!
+  * Find names of parameters and expressions used in JavaScript source
+  *
+  * The search is conservative: any identifier that is not a property access
+  * is treated as a dependency.
+  *
+  * \param[in] source JavaScript source
+  * \param[out] isDynamic true if the source may access variables indirectly (eval, this, etc.)
+  * \return list of unique identifiers
+  */
+QStringList ParametricSvgTemplate::referencedNames(const QString &source, bool *isDynamic)
+{
+    static const QStringList dynamicNames = { "eval", "Function", "this", "globalThis", "with" };
+
+    QStringList names;
+    *isDynamic = false;
+
+    int i = 0;
+    const int size = source.size();
+    while (i < size) {
+        const QChar c = source.at(i);
+        if (c.isDigit()) {
+            //Числа (в том числе 1e5, 0x1F) пропускаются целиком
+            while (i < size && (source.at(i).isLetterOrNumber() || source.at(i) == QLatin1Char('.'))) {
+                ++i;
+            }
+            continue;
+        }
+        if (!c.isLetter() && c != QLatin1Char('_') && c != QLatin1Char('$')) {
+            ++i;
+            continue;
+        }
+
+        int start = i;
+        while (i < size && (source.at(i).isLetterOrNumber()
+                            || source.at(i) == QLatin1Char('_')
+                            || source.at(i) == QLatin1Char('$'))) {
+            ++i;
+        }
+
+        //Обращение к свойству объекта (obj.name) не является зависимостью
+        int prev = start - 1;
+        while (prev >= 0 && source.at(prev).isSpace()) {
+            --prev;
+        }
+        if (prev >= 0 && source.at(prev) == QLatin1Char('.')
+                && (prev == 0 || source.at(prev - 1) != QLatin1Char('.'))) {
+            continue;
+        }
+
+        QString name = source.mid(start, i - start);
+        if (dynamicNames.contains(name)) {
+            *isDynamic = true;
+        } else if (!names.contains(name)) {
+            names.append(name);
+        }
+    }
+    return names;
+}
+
+/*!
+  * Register the expression or attribute as a reader of names used in its source
+  *
+  * \param[in,out] readers dependency graph part
+  * \param[in] source JavaScript source
+  * \param[in] index index of the expression or attribute
+  * \param[in] isDynamic true if it must be evaluated on any change
+  */
+void ParametricSvgTemplate::addReaders(QHash<QString, QVector<int> > &readers, const QString &source, int index, bool isDynamic)
+{
+    bool isDynamicSource = false;
+    QStringList names = referencedNames(source, &isDynamicSource);
+    if (isDynamic || isDynamicSource) {
+        readers[AnyName].append(index);
+    }
+    foreach (const QString &name, names) {
+        readers[name].append(index);
+    }
+}
+
+/*!
+  * Mark all expressions and attributes that depend on names as dirty.
+  * If a dynamic expression becomes dirty everything is marked
+  *
+  * \param[in] names changed parameters
+  * \param[in,out] dirtyExpressions flags of expressions to evaluate
+  * \param[in,out] dirtyBindings flags of bindings to evaluate
+  */
+void ParametricSvgTemplate::markDependents(const QSet<QString> &names,
+                                           QVector<bool> &dirtyExpressions,
+                                           QVector<bool> &dirtyBindings) const
+{
+    if (names.isEmpty()) {
+        return;
+    }
+
+    QStringList queue;
+    foreach (const QString &name, names) {
+        queue.append(name);
+    }
+    queue.append(AnyName);
+
+    QSet<QString> visited;
+    while (!queue.isEmpty()) {
+        const QString name = queue.takeLast();
+        if (visited.contains(name)) {
+            continue;
+        }
+        visited.insert(name);
+
+        foreach (int index, m_expressionReaders.value(name)) {
+            if (!dirtyExpressions.at(index)) {
+                dirtyExpressions[index] = true;
+                if (m_expressions.at(index).isDynamic) {
+                    //Динамическое выражение может изменить любые глобальные
+                    //имена, в том числе не объявленные в шаблоне
+                    dirtyExpressions.fill(true);
+                    dirtyBindings.fill(true);
+                    return;
+                }
+                queue.append(m_expressions.at(index).name);
+            }
+        }
+        foreach (int index, m_bindingReaders.value(name)) {
+            dirtyBindings[index] = true;
+        }
+    }
+}
+
+/*!
+  * Compare declarations of parameters and expressions with another
+  * version of the template
+  *
+  * \param[in] other another version of the template
+  * \return names of added, removed and changed parameters and expressions
+  */
+QStringList ParametricSvgTemplate::changedDeclarations(const ParametricSvgTemplate &other) const
+{
+    QStringList names;
+    const QStringList parameterKeys = m_parameters.keys() + other.m_parameters.keys();
+    const QSet<QString> parameterNames(parameterKeys.begin(), parameterKeys.end());
+    foreach (const QString &name, parameterNames) {
+        QMap<QString, Parameter>::const_iterator a = m_parameters.constFind(name);
+        QMap<QString, Parameter>::const_iterator b = other.m_parameters.constFind(name);
+        if(a == m_parameters.constEnd() || b == other.m_parameters.constEnd()
+                || a.value().value != b.value().value
+                || a.value().min != b.value().min
+                || a.value().max != b.value().max){
+            names.append(name);
+        }
+    }
+
+    QHash<QString, QString> expressions;
+    foreach (const Expression &exp, m_expressions) {
+        expressions.insert(exp.name, exp.value);
+    }
+    QHash<QString, QString> otherExpressions;
+    foreach (const Expression &exp, other.m_expressions) {
+        otherExpressions.insert(exp.name, exp.value);
+    }
+    const QStringList expressionKeys = expressions.keys() + otherExpressions.keys();
+    const QSet<QString> expressionNames(expressionKeys.begin(), expressionKeys.end());
+    foreach (const QString &name, expressionNames) {
+        if(!expressions.contains(name) || !otherExpressions.contains(name)
+                || expressions.value(name) != otherExpressions.value(name)){
+            names.append(name);
+        }
+    }
+
+    names.removeDuplicates();
+    names.sort();
+    return names;
+}
+
+/*!
+  * Serialize SVG document once and split it into static fragments
+  * separated by values of bindings
+  *
+  * \param[in] targets nodes patched by bindings: attributes or text nodes
+  */
+void ParametricSvgTemplate::buildRenderTemplate(const QVector<QDomNode> &targets)
+{
+    for (int i = 0; i < targets.size(); ++i) {
+        QDomNode target = targets.at(i);
+        if (target.isNull()) {
+            continue;
+        }
+        m_bindings[i].value = target.nodeValue();
+        target.setNodeValue(bindingMarker(i));
+    }
+
+    m_renderSegments = splitMarkedText(m_xmlDoc.toString(), m_bindings.size());
+
+    m_renderSize = 0;
+    for (int i = 0; i < m_renderSegments.size(); ++i) {
+        m_renderSize += m_renderSegments.at(i).data.size();
+    }
+}
+
+/*!
+  * Get marker replacing value of binding in serialized SVG
+  *
+  * \param[in] binding index of binding
+  * \return marker from the Unicode private use area
+  */
+QString ParametricSvgTemplate::bindingMarker(int binding)
+{
+    return MarkerBegin + QString::number(binding) + MarkerEnd;
+}
+
+/*!
+  * Split serialized SVG with markers of bindings into static fragments
+  *
+  * \param[in] text SVG with markers
+  * \param[in] bindingsCount number of bindings
+  * \return fragments in UTF-8
+  */
+QVector<ParametricSvgTemplate::RenderSegment> ParametricSvgTemplate::splitMarkedText(const QString &text, int bindingsCount)
+{
+    QVector<RenderSegment> segments;
+    int start = 0;
+    int begin = text.indexOf(MarkerBegin);
+    while (begin >= 0) {
+        int end = text.indexOf(MarkerEnd, begin);
+        bool ok = false;
+        int binding = end < 0 ? -1 : text.midRef(begin + MarkerBegin.size(), end - begin - MarkerBegin.size()).toInt(&ok);
+        if (ok && binding >= 0 && binding < bindingsCount) {
+            RenderSegment segment;
+            segment.data = text.midRef(start, begin - start).toUtf8();
+            segment.binding = binding;
+            segments.append(segment);
+            start = end + 1;
+        }
+        begin = text.indexOf(MarkerBegin, begin + 1);
+    }
+
+    RenderSegment tail;
+    tail.data = text.midRef(start).toUtf8();
+    tail.binding = -1;
+    segments.append(tail);
+    return segments;
+}
+
+/*!
+  * Get SVG split for instancing. It is built on the first call.
+  *
+  * \return static document and parametric overlay
+  */
+const ParametricSvgTemplate::Instancing &ParametricSvgTemplate::instancing() const
+{
+    QMutexLocker locker(&m_instancingMutex);
+    if(m_instancing.isNull()){
+        Instancing *instancing = new Instancing;
+        buildInstancing(instancing);
+        m_instancing.reset(instancing);
+    }
+    return *m_instancing;
+}
+
+/*!
+  * Split SVG into the static document without parametric elements
+  * and the overlay with parametric elements only. Elements of the overlay
+  * are painted over the whole static document.
+  *
+  * \param[out] instancing result
+  */
+void ParametricSvgTemplate::buildInstancing(Instancing *instancing) const
+{
+    //SVG с маркерами вместо значений привязок
+    QString text;
+    foreach (const RenderSegment &segment, m_renderSegments) {
+        text += QString::fromUtf8(segment.data);
+        if (segment.binding >= 0) {
+            text += bindingMarker(segment.binding);
+        }
+    }
+
+    QDomDocument staticDoc;
+    if(!staticDoc.setContent(text)){
+        return;
+    }
+    QDomElement staticRoot = staticDoc.documentElement();
+    if(isMarked(staticRoot)){
+        return;
+    }
+    //Общие определения не должны зависеть от параметров
+    for (QDomElement child = staticRoot.firstChildElement(); !child.isNull(); child = child.nextSiblingElement()) {
+        const QString tagName = child.tagName().section(QLatin1Char(':'), -1);
+        if(tagName != "defs" && tagName != "style"){
+            continue;
+        }
+        QString definitions;
+        QTextStream stream(&definitions);
+        child.save(stream, -1);
+        stream.flush();
+        if(definitions.contains(MarkerBegin)){
+            return;
+        }
+    }
+
+    QDomDocument overlayDoc = staticDoc.cloneNode(true).toDocument();
+    removeParametric(staticRoot);
+    keepParametric(overlayDoc.documentElement());
+    //Правила CSS могут относиться к путям, поэтому такие пути рисует рендерер
+    if(overlayDoc.elementsByTagName("style").isEmpty()){
+        extractNativePaths(overlayDoc.documentElement(), instancing->nativePaths);
+    }
+
+    instancing->staticSvg = staticDoc.toByteArray();
+    instancing->overlaySegments = splitMarkedText(overlayDoc.toString(), m_bindings.size());
+    instancing->isValid = true;
+}
+
+/*!
+  * Check whether attributes or text of the element depend on parameters
+  *
+  * \param[in] element XML element
+  * \return true, if there are markers of bindings
+  */
+bool ParametricSvgTemplate::isMarked(const QDomElement &element)
+{
+    const QDomNamedNodeMap attributes = element.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        if(attributes.item(i).nodeValue().contains(MarkerBegin)){
+            return true;
+        }
+    }
+    for (QDomNode child = element.firstChild(); !child.isNull(); child = child.nextSibling()) {
+        if(child.isCharacterData() && child.nodeValue().contains(MarkerBegin)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+  * Remove elements depending on parameters together with their children
+  *
+  * \param[in] element parent element
+  */
+void ParametricSvgTemplate::removeParametric(QDomElement element)
+{
+    QDomElement child = element.firstChildElement();
+    while (!child.isNull()) {
+        QDomElement next = child.nextSiblingElement();
+        if(isMarked(child)){
+            element.removeChild(child);
+        }else{
+            removeParametric(child);
+        }
+        child = next;
+    }
+}
+
+/*!
+  * Keep only elements depending on parameters, their children and ancestors.
+  * Definitions and styles are kept for references from the kept elements.
+  *
+  * \param[in] element parent element
+  * \return true, if something is kept
+  */
+bool ParametricSvgTemplate::keepParametric(QDomElement element)
+{
+    bool isKept = false;
+    QDomNode child = element.firstChild();
+    while (!child.isNull()) {
+        QDomNode next = child.nextSibling();
+        if(!child.isElement()){
+            //Статический текст элемента остаётся в общем документе
+            if(!child.isProcessingInstruction()){
+                element.removeChild(child);
+            }
+            child = next;
+            continue;
+        }
+
+        QDomElement childElement = child.toElement();
+        const QString tagName = childElement.tagName().section(QLatin1Char(':'), -1);
+        if(tagName == "defs" || tagName == "style" || isMarked(childElement) || keepParametric(childElement)){
+            isKept = true;
+        }else{
+            element.removeChild(child);
+        }
+        child = next;
+    }
+    return isKept;
+}
+
+/*!
+  * Move paths, which can be drawn without QSvgRenderer, from the overlay
+  * to the list of native paths in the document order
+  *
+  * \param[in] element parent element of the overlay
+  * \param[out] nativePaths native paths
+  */
+void ParametricSvgTemplate::extractNativePaths(QDomElement element, QVector<NativePath> &nativePaths) const
+{
+    QDomElement child = element.firstChildElement();
+    while (!child.isNull()) {
+        QDomElement next = child.nextSiblingElement();
+        if(!isMarked(child)){
+            extractNativePaths(child, nativePaths);
+        }else{
+            NativePath nativePath;
+            if(toNativePath(child, &nativePath)){
+                nativePaths.append(nativePath);
+                element.removeChild(child);
+            }
+        }
+        child = next;
+    }
+}
+
+/*!
+  * Check that only the `d` attribute of the path depends on parameters
+  * and its style is supported, and compile the path data
+  *
+  * \param[in] element parametric element of the overlay
+  * \param[out] nativePath path with style
+  * \return false, if the element must be drawn by QSvgRenderer
+  */
+bool ParametricSvgTemplate::toNativePath(const QDomElement &element, NativePath *nativePath) const
+{
+    if(element.tagName() != "path" || !element.firstChildElement().isNull()){
+        return false;
+    }
+    for (QDomNode child = element.firstChild(); !child.isNull(); child = child.nextSibling()) {
+        if(child.isCharacterData() && child.nodeValue().contains(MarkerBegin)){
+            return false;
+        }
+    }
+    const QDomNamedNodeMap attributes = element.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        const QDomNode attribute = attributes.item(i);
+        if(attribute.nodeValue().contains(MarkerBegin) && attribute.nodeName() != "d"){
+            return false;
+        }
+    }
+    const int binding = markedBinding(element.attribute("d"), m_bindings.size());
+    if(binding < 0 || !resolveNativeStyle(element, nativePath)){
+        return false;
+    }
+
+    nativePath->binding = binding;
+    //Без числовых ячеек путь строится из вычисленной строки
+    nativePath->path.compile(m_bindings.at(binding).source, m_nameIndex);
+    return true;
+}
+
+/*!
+  * Resolve pen, brush, opacity and transform of the path from its attributes,
+  * `style` and the inherited properties of its ancestors
+  *
+  * \param[in] element path element
+  * \param[out] nativePath path with style
+  * \return false, if some property is not supported
+  */
+bool ParametricSvgTemplate::resolveNativeStyle(const QDomElement &element, NativePath *nativePath)
+{
+    QVector<QDomElement> chain;
+    for (QDomElement e = element; !e.isNull(); e = e.parentNode().toElement()) {
+        chain.prepend(e);
+    }
+
+    static const QSet<QString> rootAttributes = {
+        "viewBox", "width", "height", "x", "y", "version", "baseProfile", "preserveAspectRatio"
+    };
+    QHash<QString, QString> properties;
+    QTransform transform;
+    for (int i = 0; i < chain.size(); ++i) {
+        const QDomElement &e = chain.at(i);
+        const bool isRoot = i == 0;
+        const bool isPath = i == chain.size() - 1;
+        if(!isRoot && !isPath && e.tagName() != "g"){
+            return false;
+        }
+
+        QHash<QString, QString> own;
+        QString style;
+        const QDomNamedNodeMap attributes = e.attributes();
+        for (int j = 0; j < attributes.count(); ++j) {
+            const QDomNode attribute = attributes.item(j);
+            const QString name = attribute.nodeName();
+            const QString value = attribute.nodeValue().trimmed();
+            //Атрибуты других пространств имён не влияют на отрисовку
+            if(name.contains(QLatin1Char(':')) || name.startsWith(QLatin1String("xmlns")) || name == "id"
+                    || (isPath && name == "d") || (isRoot && rootAttributes.contains(name))){
+                continue;
+            }
+            if(name == "style"){
+                style = value;
+                continue;
+            }
+            if(name == "transform"){
+                QTransform t;
+                if(!parseTransform(value, &t)){
+                    return false;
+                }
+                transform = t * transform;
+                continue;
+            }
+            if(!isNativeProperty(name)){
+                return false;
+            }
+            own.insert(name, value);
+        }
+
+        //Свойства из style важнее атрибутов
+        foreach (const QString &declaration, style.split(QLatin1Char(';'), Qt::SkipEmptyParts)) {
+            const int colon = declaration.indexOf(QLatin1Char(':'));
+            const QString name = declaration.left(colon).trimmed();
+            if(colon < 0 || name.isEmpty()){
+                continue;
+            }
+            if(!isNativeProperty(name)){
+                return false;
+            }
+            own.insert(name, declaration.mid(colon + 1).trimmed());
+        }
+
+        for (QHash<QString, QString>::const_iterator p = own.constBegin(); p != own.constEnd(); ++p) {
+            if(p.value() == "inherit"){
+                continue;
+            }
+            //Прозрачность группы не равна прозрачности отдельных элементов
+            if(p.key() == "opacity" && !isPath){
+                bool ok = false;
+                if(p.value().toDouble(&ok) != 1.0 || !ok){
+                    return false;
+                }
+                continue;
+            }
+            properties.insert(p.key(), p.value());
+        }
+    }
+
+    bool ok = true;
+    const qreal opacity = properties.value("opacity", "1").toDouble(&ok);
+    if(!ok){
+        return false;
+    }
+    const qreal fillOpacity = properties.value("fill-opacity", "1").toDouble(&ok);
+    if(!ok){
+        return false;
+    }
+    const qreal strokeOpacity = properties.value("stroke-opacity", "1").toDouble(&ok);
+    if(!ok){
+        return false;
+    }
+
+    const QString fill = properties.value("fill", "black");
+    QBrush brush(Qt::NoBrush);
+    if(fill != "none"){
+        QColor color;
+        if(!parseColor(fill, &color)){
+            return false;
+        }
+        color.setAlphaF(color.alphaF() * qBound(0.0, fillOpacity, 1.0));
+        brush = QBrush(color);
+    }
+
+    const QString fillRule = properties.value("fill-rule", "nonzero");
+    if(fillRule != "nonzero" && fillRule != "evenodd"){
+        return false;
+    }
+
+    const QString stroke = properties.value("stroke", "none");
+    double width = 1.0;
+    if(!parseLength(properties.value("stroke-width", "1"), &width)){
+        return false;
+    }
+    QPen pen(Qt::NoPen);
+    //Перо нулевой ширины в Qt рисует линию в один пиксель
+    if(stroke != "none" && width > 0){
+        QColor color;
+        if(!parseColor(stroke, &color)){
+            return false;
+        }
+        color.setAlphaF(color.alphaF() * qBound(0.0, strokeOpacity, 1.0));
+
+        const QString linecap = properties.value("stroke-linecap", "butt");
+        const QString linejoin = properties.value("stroke-linejoin", "miter");
+        const QHash<QString, Qt::PenCapStyle> caps = {
+            {"butt", Qt::FlatCap}, {"round", Qt::RoundCap}, {"square", Qt::SquareCap}
+        };
+        const QHash<QString, Qt::PenJoinStyle> joins = {
+            {"miter", Qt::SvgMiterJoin}, {"round", Qt::RoundJoin}, {"bevel", Qt::BevelJoin}
+        };
+        const qreal miterLimit = properties.value("stroke-miterlimit", "4").toDouble(&ok);
+        if(!caps.contains(linecap) || !joins.contains(linejoin) || !ok){
+            return false;
+        }
+        pen = QPen(QBrush(color), width, Qt::SolidLine, caps.value(linecap), joins.value(linejoin));
+        pen.setMiterLimit(miterLimit);
+    }
+
+    nativePath->pen = pen;
+    nativePath->brush = brush;
+    nativePath->opacity = qBound(0.0, opacity, 1.0);
+    nativePath->transform = transform;
+    nativePath->path.setFillRule(fillRule == "evenodd" ? Qt::OddEvenFill : Qt::WindingFill);
+    return true;
+}
+
+/*!
+  * Get binding, whose marker is the whole value
+  *
+  * \param[in] value attribute value with marker
+  * \param[in] bindingsCount number of bindings
+  * \return index of binding or -1
+  */
+int ParametricSvgTemplate::markedBinding(const QString &value, int bindingsCount)
+{
+    if(!value.startsWith(MarkerBegin) || !value.endsWith(MarkerEnd)){
+        return -1;
+    }
+    bool ok = false;
+    const int binding = value.midRef(MarkerBegin.size(), value.size() - MarkerBegin.size() - 1).toInt(&ok);
+    return ok && binding >= 0 && binding < bindingsCount ? binding : -1;
+}
+
+/*!
+  * Check that the node is not empty and has attributes
+  *
+  * \param[in] node link to XML node
+  * \return true if valid
+  */
+bool ParametricSvgTemplate::domNodeIsValid(const QDomNode &node)
+{
+    return !node.isNull() && node.isElement() && node.hasAttributes();
+}
+
+QString ParametricSvgTemplate::getLocalName(const QString &qName)
+{
+    return getToken(qName, 1);
+}
+
+QString ParametricSvgTemplate::getUri(const QString &qName)
+{
+    return getToken(qName, 0);
+}
+
+QString ParametricSvgTemplate::getToken(const QString &qName, const int index, const QString delimeter)
+{
+    if(index < 0){
+        return QString();
+    }
+    QStringList list = qName.split(delimeter);
+    if(list.size() < 2){
+        return QString();
+    }
+
+    return list[index];
+}
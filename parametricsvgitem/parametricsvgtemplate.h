@@ -0,0 +1,226 @@
+#ifndef PARAMETRICSVGTEMPLATE_H
+#define PARAMETRICSVGTEMPLATE_H
+
+
+#include <QDateTime>
+#include <QDomDocument>
+#include <QFile>
+#include <QHash>
+#include <QJSValue>
+#include <QMap>
+#include <QScopedPointer>
+#include <QMutex>
+#include <QSet>
+#include <QBrush>
+#include <QPen>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTransform>
+#include <QVariant>
+#include <QVector>
+#include "parametricexpression.h"
+#include "parametricsvgpath.h"
+
+class QFileInfo;
+class QJSEngine;
+
+class ParametricSvgTemplate
+{
+public:
+    struct Parameter
+    {
+        QVariant value;
+        qreal min;
+        qreal max;
+        QString name;
+    };
+
+    struct Expression {
+        QString name;
+        QString value;
+        //Зависимости не удалось определить (eval, скрипт и т.п.)
+        bool isDynamic = false;
+        //Индекс значения в таблице имён
+        int nameIndex = -1;
+        //Невалидно, если выражение вычисляется через QJSEngine
+        ParametricExpression native;
+    };
+
+    //Место подстановки значения шаблона в SVG
+    struct Binding {
+        QString source;
+        //Значение атрибута или текста в исходном SVG
+        QString value;
+        bool isDynamic = false;
+        ParametricExpression native;
+    };
+
+    //Неизменяемый фрагмент SVG (UTF-8) и индекс значения, подставляемого после него
+    struct RenderSegment {
+        QByteArray data;
+        int binding;
+    };
+
+    //Путь с параметрическим атрибутом d, который рисуется без QSvgRenderer
+    struct NativePath {
+        int binding = -1;
+        //Невалиден, если данные пути нельзя скомпилировать с числовыми ячейками
+        ParametricSvgPath path;
+        QPen pen;
+        QBrush brush;
+        qreal opacity = 1.0;
+        //Преобразование в систему координат корневого элемента
+        QTransform transform;
+    };
+
+    //Разделение SVG для отрисовки множества экземпляров
+    struct Instancing {
+        //Документ без элементов, зависящих от параметров; общий для всех экземпляров
+        QByteArray staticSvg;
+        //Документ только из элементов, зависящих от параметров, и их предков
+        QVector<RenderSegment> overlaySegments;
+        //Пути, исключённые из наложения; рисуются между общей частью и наложением
+        QVector<NativePath> nativePaths;
+        //false, если от параметров зависят общие определения (defs, style)
+        bool isValid = false;
+    };
+
+    ~ParametricSvgTemplate();
+
+    static QSharedPointer<const ParametricSvgTemplate> load(const QString &fname, const QString &namespaceName);
+    static QJSValue compileSource(QJSEngine *jsEngine, const QString &source);
+    static QString compiledFileName(const QString &fname);
+
+    bool saveCompiled(const QString &fname) const;
+
+    int id() const;
+    QString fileName() const;
+    QString namespaceName() const;
+
+    const QMap<QString, Parameter> &parameters() const;
+    const QStringList &names() const;
+    const QHash<QString, int> &nameIndex() const;
+    const QList<Expression> &expressions() const;
+    const QVector<Binding> &bindings() const;
+    const QVector<RenderSegment> &renderSegments() const;
+    int renderSize() const;
+    const Instancing &instancing() const;
+
+    QStringList changedDeclarations(const ParametricSvgTemplate &other) const;
+
+    void markDependents(const QSet<QString> &names,
+                        QVector<bool> &dirtyExpressions,
+                        QVector<bool> &dirtyBindings) const;
+
+private:
+    ParametricSvgTemplate(const QString &fname, const QString &namespaceName);
+
+    //Кэш шаблонов: путь к файлу и пространство имён -> шаблон
+    struct CacheEntry {
+        QDateTime modified;
+        qint64 size;
+        QWeakPointer<const ParametricSvgTemplate> svgTemplate;
+    };
+    static QHash<QString, CacheEntry> &cache();
+    static QSharedPointer<const ParametricSvgTemplate> cachedTemplate(const QString &key, const QFileInfo &info);
+
+    //Уникальный в пределах процесса номер шаблона
+    int m_id;
+    QString m_fileName;
+    //Размер и время изменения файла на момент разбора
+    qint64 m_sourceSize;
+    QDateTime m_sourceModified;
+    QString m_namespace;
+    QDomDocument m_xmlDoc;
+
+    //Размеры компонента по умолчанию
+    QMap<QString, Parameter> m_parameters;
+    //Выражения JS
+    QList<Expression> m_expressions;
+    //Таблица имён: сначала параметры, затем выражения
+    QStringList m_names;
+    QHash<QString, int> m_nameIndex;
+    //Таблица мест подстановки шаблонов атрибутов
+    QVector<Binding> m_bindings;
+    //Граф зависимостей: имя -> индексы выражений и атрибутов, читающих его
+    QHash<QString, QVector<int> > m_expressionReaders;
+    QHash<QString, QVector<int> > m_bindingReaders;
+    //Шаблон SVG для отрисовки
+    QVector<RenderSegment> m_renderSegments;
+    int m_renderSize;
+    //Копия файла, на которую ссылаются фрагменты, если файл разобран потоково,
+    //или блок фрагментов в отображении скомпилированного шаблона
+    QByteArray m_source;
+    //Скомпилированный шаблон остаётся отображённым, пока жив шаблон
+    QFile m_compiledFile;
+    //Создаётся при первом обращении
+    mutable QMutex m_instancingMutex;
+    mutable QScopedPointer<Instancing> m_instancing;
+
+    //Диапазон байтов исходного файла, заменяемый значением привязки
+    struct Site {
+        int begin;
+        int end;
+        int binding;
+    };
+
+    //Перевод смещений QXmlStreamReader (символы UTF-16) в байты UTF-8
+    class Utf8Offsets {
+    public:
+        Utf8Offsets(const QByteArray &data, int byte);
+        int toByte(qint64 character);
+    private:
+        const QByteArray &m_data;
+        qint64 m_character;
+        int m_byte;
+    };
+
+    //методы
+    bool setContent();
+    bool readCompiled();
+    bool readStream();
+    bool scanStream(const QByteArray &data, QVector<Site> &sites);
+    bool readDom();
+    bool readXmlFromFile(const QString &fname);
+    bool readParameters(const QDomNode &node);
+    bool readExpressions(const QDomNode &node);
+
+    QString getUri(const QString &qName);
+    QString getLocalName(const QString &qName);
+    QString getToken(const QString &qName, const int index, const QString delimeter = ":");
+
+    void addParameter(const QString &pName, const Parameter &param);
+    void addExpression(const Expression &exp);
+
+    bool domNodeIsValid(const QDomNode &node);
+    Parameter domNodeToParameter(const QDomNode &node);
+    Expression domNodeToExpression(const QDomNode &node);
+    Parameter makeParameter(const QString &nameParam, const QString &valueParam,
+                            const QString &minParam, const QString &maxParam);
+    Expression makeExpression(const QString &variableName, const QString &variableValue);
+
+    void buildNameTable();
+    void collectBindings(const QDomNode &node, QVector<QDomNode> &targets);
+    void classifySources();
+    void buildDependencyGraph();
+    void buildRenderTemplate(const QVector<QDomNode> &targets);
+    void buildInstancing(Instancing *instancing) const;
+
+    static QString bindingMarker(int binding);
+    static bool isMarked(const QDomElement &element);
+    static void removeParametric(QDomElement element);
+    static bool keepParametric(QDomElement element);
+    void extractNativePaths(QDomElement element, QVector<NativePath> &nativePaths) const;
+    bool toNativePath(const QDomElement &element, NativePath *nativePath) const;
+    static bool resolveNativeStyle(const QDomElement &element, NativePath *nativePath);
+    static int markedBinding(const QString &value, int bindingsCount);
+    static QVector<RenderSegment> splitMarkedText(const QString &text, int bindingsCount);
+
+    static bool findAttributeValue(const QByteArray &data, int begin, int end, const QByteArray &name,
+                                   int *valueBegin, int *valueEnd);
+    static bool isXmlSpace(char c);
+    static QStringList referencedNames(const QString &source, bool *isDynamic);
+    static void addReaders(QHash<QString, QVector<int> > &readers, const QString &source, int index, bool isDynamic);
+};
+
+#endif // PARAMETRICSVGTEMPLATE_H
@@ -0,0 +1,90 @@
+/*!
+ * \class ParametricSvgWatchdog
+ * Thread interrupting JavaScript evaluations, which exceed their time budget
+ */
+#include "parametricsvgwatchdog.h"
+#include <QJSEngine>
+
+ParametricSvgWatchdog::ParametricSvgWatchdog():
+    m_isStopped(false)
+{
+}
+
+ParametricSvgWatchdog::~ParametricSvgWatchdog()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_isStopped = true;
+        m_condition.wakeAll();
+    }
+    wait();
+}
+
+/*!
+  * Get the watchdog shared by all documents. The thread is started on the first call.
+  *
+  * \return watchdog instance
+  */
+ParametricSvgWatchdog *ParametricSvgWatchdog::instance()
+{
+    static ParametricSvgWatchdog watchdog;
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    if(!watchdog.isRunning()){
+        watchdog.start(QThread::HighPriority);
+    }
+    return &watchdog;
+}
+
+/*!
+  * Interrupt evaluation in the engine at the deadline.
+  * The engine must be disarmed before it is deleted.
+  *
+  * \param[in] engine JavaScript engine
+  * \param[in] deadline moment of interruption
+  */
+void ParametricSvgWatchdog::arm(QJSEngine *engine, const QDeadlineTimer &deadline)
+{
+    QMutexLocker locker(&m_mutex);
+    m_deadlines.insert(engine, deadline);
+    m_condition.wakeAll();
+}
+
+/*!
+  * Cancel interruption of the engine
+  *
+  * \param[in] engine JavaScript engine
+  */
+void ParametricSvgWatchdog::disarm(QJSEngine *engine)
+{
+    QMutexLocker locker(&m_mutex);
+    m_deadlines.remove(engine);
+}
+
+void ParametricSvgWatchdog::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_isStopped) {
+        if(m_deadlines.isEmpty()){
+            m_condition.wait(&m_mutex);
+            continue;
+        }
+
+        //Ближайший срок среди всех движков
+        QHash<QJSEngine *, QDeadlineTimer>::iterator nearest = m_deadlines.begin();
+        for (QHash<QJSEngine *, QDeadlineTimer>::iterator i = m_deadlines.begin(); i != m_deadlines.end(); ++i) {
+            if(i.value() < nearest.value()){
+                nearest = i;
+            }
+        }
+
+        const qint64 remaining = nearest.value().remainingTime();
+        if(remaining > 0){
+            m_condition.wait(&m_mutex, static_cast<unsigned long>(remaining));
+            continue;
+        }
+        //Вызывается под мьютексом, поэтому движок ещё не удалён
+        nearest.key()->setInterrupted(true);
+        m_deadlines.erase(nearest);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef PARAMETRICSVGWATCHDOG_H
+#define PARAMETRICSVGWATCHDOG_H
+
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class QJSEngine;
+
+class ParametricSvgWatchdog : public QThread
+{
+private:
+    //Движки JS и моменты их прерывания
+    QHash<QJSEngine *, QDeadlineTimer> m_deadlines;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    bool m_isStopped;
+
+    ParametricSvgWatchdog();
+
+protected:
+    void run() override;
+
+public:
+    ~ParametricSvgWatchdog();
+
+    static ParametricSvgWatchdog *instance();
+
+    void arm(QJSEngine *engine, const QDeadlineTimer &deadline);
+    void disarm(QJSEngine *engine);
+};
+
+#endif // PARAMETRICSVGWATCHDOG_H
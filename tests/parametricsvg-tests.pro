@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Unit tests of parametric SVG evaluation
+#
+#-------------------------------------------------
+
+QT       += core testlib
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = parametricsvg-tests
+TEMPLATE = app
+
+SOURCES += tst_parametricexpression.cpp
+
+include(../parametricsvgitem/parametricsvgdocument.pri)
@@ -0,0 +1,239 @@
+/*!
+ * Comparison of the native evaluator of expressions with QJSEngine.
+ * Every expression accepted by ParametricExpression must give
+ * the same value as JavaScript.
+ */
+#include "parametricexpression.h"
+
+#include <QJSEngine>
+#include <QtTest>
+#include <cmath>
+
+class ParametricExpressionTest : public QObject
+{
+    Q_OBJECT
+private:
+    QHash<QString, int> m_names;
+    QVector<ParametricExpression::Value> m_environment;
+    QJSEngine m_engine;
+
+
+    //методы
+    void addVariable(const QString &name, const QVariant &value);
+    void addSources(const QStringList &sources);
+    static QString describe(const ParametricExpression::Value &value);
+    static QString describe(const QJSValue &value);
+    static bool isSame(const ParametricExpression::Value &value, const QJSValue &expected);
+
+private slots:
+    void initTestCase();
+
+    void operators_data();
+    void operators();
+    void coercions_data();
+    void coercions();
+    void math_data();
+    void math();
+    void numberToString_data();
+    void numberToString();
+    void templateLiterals_data();
+    void templateLiterals();
+    void rejected_data();
+    void rejected();
+};
+
+void ParametricExpressionTest::initTestCase()
+{
+    addVariable("A", 3);
+    addVariable("B", -2.5);
+    addVariable("Z", 0);
+    addVariable("S", QString("12"));
+    addVariable("T", QString("abc"));
+    addVariable("E", QString(""));
+    addVariable("F", false);
+}
+
+void ParametricExpressionTest::addVariable(const QString &name, const QVariant &value)
+{
+    m_names.insert(name, m_environment.size());
+    m_environment.append(ParametricExpression::Value::fromVariant(value));
+    m_engine.globalObject().setProperty(name, m_engine.toScriptValue(value));
+}
+
+void ParametricExpressionTest::addSources(const QStringList &sources)
+{
+    QTest::addColumn<QString>("source");
+    foreach (const QString &source, sources) {
+        QTest::newRow(qPrintable(source)) << source;
+    }
+}
+
+QString ParametricExpressionTest::describe(const ParametricExpression::Value &value)
+{
+    switch (value.type) {
+    case ParametricExpression::Value::Undefined:
+        return "undefined";
+    case ParametricExpression::Value::Boolean:
+        return value.toBoolean() ? "true" : "false";
+    case ParametricExpression::Value::Number:
+        return QString("number %1%2").arg(std::signbit(value.number) ? "-" : "+").arg(value.number, 0, 'g', 17);
+    default:
+        return QString("string \"%1\"").arg(value.string);
+    }
+}
+
+QString ParametricExpressionTest::describe(const QJSValue &value)
+{
+    if(value.isNumber()){
+        const double number = value.toNumber();
+        return QString("number %1%2").arg(std::signbit(number) ? "-" : "+").arg(number, 0, 'g', 17);
+    }
+    if(value.isString()){
+        return QString("string \"%1\"").arg(value.toString());
+    }
+    return value.toString();
+}
+
+/*!
+  * Compare types and values. Numbers are compared exactly,
+  * including NaN and the sign of zero.
+  *
+  * \param[in] value result of ParametricExpression
+  * \param[in] expected result of QJSEngine
+  * \return true, if they are the same
+  */
+bool ParametricExpressionTest::isSame(const ParametricExpression::Value &value, const QJSValue &expected)
+{
+    if(expected.isNumber()){
+        const double number = expected.toNumber();
+        if(value.type != ParametricExpression::Value::Number){
+            return false;
+        }
+        if(qIsNaN(number)){
+            return qIsNaN(value.number);
+        }
+        return value.number == number && std::signbit(value.number) == std::signbit(number);
+    }
+    if(expected.isString()){
+        return value.type == ParametricExpression::Value::String && value.string == expected.toString();
+    }
+    if(expected.isBool()){
+        return value.type == ParametricExpression::Value::Boolean && value.toBoolean() == expected.toBool();
+    }
+    return expected.isUndefined() && value.isUndefined();
+}
+
+#define COMPARE_WITH_ENGINE() \
+    do { \
+        QFETCH(QString, source); \
+        ParametricExpression expression; \
+        QVERIFY2(expression.compile(source, m_names), "not compiled natively"); \
+        ParametricExpression::Value value; \
+        QString error; \
+        QVERIFY2(expression.evaluate(m_environment, &value, &error), qPrintable(error)); \
+        const QJSValue expected = m_engine.evaluate(source); \
+        QVERIFY2(!expected.isError(), qPrintable(expected.toString())); \
+        QVERIFY2(isSame(value, expected), qPrintable(describe(value) + " != " + describe(expected))); \
+    } while (false)
+
+void ParametricExpressionTest::operators_data()
+{
+    addSources(QStringList()
+               << "A + B" << "A - B * 2" << "(A + 1) * (B - 1)" << "A / Z" << "-A / Z" << "Z / Z"
+               << "A % 2" << "B % 2" << "-A % 3" << "A % Z" << "-Z" << "+S" << "-(-A)"
+               << "A > B" << "A >= 3" << "A <= B" << "A < S" << "T < S" << "T > 'abb'"
+               << "A == '3'" << "A === '3'" << "A != S" << "A !== 3" << "F == Z" << "E == Z"
+               << "!A" << "!E" << "!T" << "!!Z"
+               << "A && B" << "Z && B" << "Z || T" << "E || 'x'" << "F || Z"
+               << "A > 2 ? 'big' : 'small'" << "Z ? 1 : B ? 2 : 3"
+               << "1 - 2 - 3" << "2 * 3 % 4" << "1 + 2 * 3 - 4 / 8");
+}
+
+void ParametricExpressionTest::operators()
+{
+    COMPARE_WITH_ENGINE();
+}
+
+void ParametricExpressionTest::coercions_data()
+{
+    addSources(QStringList()
+               << "S + A" << "A + S" << "S - 1" << "S * '2'" << "T * 1" << "E * 1"
+               << "' 12 ' * 1" << "'\\t5\\n' - 0" << "'Infinity' * 1" << "'-Infinity' * 1" << "'1e3' * 1"
+               << "'.5' * 1" << "'5.' * 1" << "'1,5' * 1" << "'inf' * 1"
+               << "'0x10' * 1" << "'0b101' * 1" << "'0o17' * 1" << "'-0x10' * 1" << "'0x' * 1"
+               << "F + 1" << "F + ''" << "true + 1" << "true + 'x'" << "A + true + S"
+               << "'' + (A / 7)" << "1 / (Z * -1)" << "S == 12" << "T == 0" << "F == ''");
+}
+
+void ParametricExpressionTest::coercions()
+{
+    COMPARE_WITH_ENGINE();
+}
+
+void ParametricExpressionTest::math_data()
+{
+    addSources(QStringList()
+               << "Math.round(2.5)" << "Math.round(-2.5)" << "Math.round(-0.2)" << "Math.round(-0.5)"
+               << "Math.round(0.49999999999999994)" << "Math.round(-0.6)" << "Math.round(B)"
+               << "Math.round(4503599627370497)" << "Math.round(A / Z)" << "Math.round(T)"
+               << "Math.floor(B)" << "Math.ceil(B)" << "Math.ceil(-0.5)" << "Math.trunc(B)" << "Math.abs(B)"
+               << "Math.sign(B)" << "Math.sign(-Z)" << "Math.sign(T)"
+               << "Math.max(A, B, 7)" << "Math.min(A, B)" << "Math.max()" << "Math.min()" << "Math.max(A, T)"
+               << "Math.max(S, 4)" << "Math.sqrt(-1)" << "Math.sqrt(A)" << "Math.pow(2, 0.5)" << "Math.pow(A, -2)"
+               << "Math.atan2(1, 1)" << "Math.exp(1)" << "Math.log(A)" << "Math.sin(Math.PI / 6)"
+               << "Math.cos(Z)" << "Math.tan(1)" << "Math.asin(1)" << "Math.acos(2)" << "Math.atan(A)"
+               << "Math.PI" << "Math.E" << "Math.LN2" << "Math.LN10" << "Math.SQRT2");
+}
+
+void ParametricExpressionTest::math()
+{
+    COMPARE_WITH_ENGINE();
+}
+
+void ParametricExpressionTest::numberToString_data()
+{
+    addSources(QStringList()
+               << "'' + 0.1 + 0.2" << "'' + (0.1 + 0.2)" << "'' + 1e21" << "'' + 1e20" << "'' + 123456789012345680000"
+               << "'' + 1e-6" << "'' + 1e-7" << "'' + 1.5e-7" << "'' + -Z" << "'' + A / 7" << "'' + B * 1e300 * 10"
+               << "'' + Z / Z" << "'' + 100" << "'' + 2.5e25" << "'' + 5e-324" << "'' + 1.7976931348623157e308"
+               << "'' + 0.000001234" << "'' + 123.456");
+}
+
+void ParametricExpressionTest::numberToString()
+{
+    COMPARE_WITH_ENGINE();
+}
+
+void ParametricExpressionTest::templateLiterals_data()
+{
+    addSources(QStringList()
+               << "`x=${A}`" << "`${A + B}px ${S}`" << "`${A}${B}${T}`" << "`plain`" << "``"
+               << "`a\\nb`" << "`\\${A}`" << "`${A > 2 ? `${S}!` : T}`" << "`${F}`" << "`${A / Z}`"
+               << "`${'}'}`" << "`${Math.round(B)}%`");
+}
+
+void ParametricExpressionTest::templateLiterals()
+{
+    COMPARE_WITH_ENGINE();
+}
+
+void ParametricExpressionTest::rejected_data()
+{
+    addSources(QStringList()
+               << "0x10" << "010" << "0b1" << "0o7" << "A.toFixed(2)" << "A = 1" << "U + 1"
+               << "Math.random()" << "eval('A')" << "A ** 2" << "[A]" << "A; B");
+}
+
+/*!
+  * Sources outside the supported subset must be left to QJSEngine
+  */
+void ParametricExpressionTest::rejected()
+{
+    QFETCH(QString, source);
+    ParametricExpression expression;
+    QVERIFY(!expression.compile(source, m_names));
+}
+
+QTEST_GUILESS_MAIN(ParametricExpressionTest)
+
+#include "tst_parametricexpression.moc"
@@ -0,0 +1,34 @@
+#ifndef BATCHROW_H
+#define BATCHROW_H
+
+
+#include <QSize>
+#include <QString>
+#include <QVariantMap>
+
+//Набор значений параметров из одной строки входного файла
+struct BatchRow
+{
+    qint64 number = 0;
+    QVariantMap values;
+};
+
+//Настройки, общие для всех потоков
+struct BatchOptions
+{
+    enum Format {
+        Svg,
+        Png
+    };
+
+    QString templateFile;
+    QString namespaceName;
+    QString outputDir;
+    Format format = Svg;
+    //Столбец с именем выходного файла; по умолчанию номер строки
+    QString nameColumn;
+    //Размер PNG; по умолчанию размер из SVG
+    QSize size;
+};
+
+#endif // BATCHROW_H
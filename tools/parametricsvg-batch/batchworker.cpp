@@ -0,0 +1,155 @@
+/*!
+ * \class BatchWorker
+ * Thread rendering rows from the queue with its own evaluation context
+ */
+#include "batchworker.h"
+#include "rowqueue.h"
+#include "parametricsvgdocument.h"
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QSvgRenderer>
+
+BatchWorker::BatchWorker(RowQueue *queue, const ParametricSvgDocument *probe, const BatchOptions &options, QObject *parent):
+    QThread(parent),
+    m_queue(queue),
+    m_probe(probe),
+    m_options(options),
+    m_rendered(0),
+    m_failed(0)
+{
+}
+
+/*!
+  * Get number of written files
+  *
+  * \return number of rows
+  */
+qint64 BatchWorker::rendered() const
+{
+    return m_rendered.load();
+}
+
+/*!
+  * Get number of rows with errors
+  *
+  * \return number of rows
+  */
+qint64 BatchWorker::failed() const
+{
+    return m_failed.load();
+}
+
+void BatchWorker::run()
+{
+    //Документ и движок JS принадлежат этому потоку; шаблон общий и не перечитывается,
+    //даже если файл изменился после проверки
+    ParametricSvgDocument document(m_options.namespaceName);
+    document.copyFrom(*m_probe);
+
+    //Строки забираются и при ошибке, иначе очередь переполнится и чтение зависнет
+    BatchRow row;
+    while (m_queue->pop(&row)) {
+        if(document.isNull()){
+            m_failed.ref();
+        }else if(renderRow(document, row)){
+            m_rendered.ref();
+        }else{
+            m_failed.ref();
+        }
+    }
+}
+
+/*!
+  * Evaluate the document with parameter values from the row and write the result
+  *
+  * \param[in,out] document evaluation context of this thread
+  * \param[in] row parameter values
+  * \return true on succes
+  */
+bool BatchWorker::renderRow(ParametricSvgDocument &document, const BatchRow &row)
+{
+    //Значения из предыдущей строки не переходят в следующую
+    document.resetParameters();
+
+    bool isOk = true;
+    QVariantMap::const_iterator i = row.values.constBegin();
+    for (; i != row.values.constEnd(); ++i) {
+        if(i.key() == m_options.nameColumn || !document.parameterIsExist(i.key())){
+            continue;
+        }
+        if(!document.setParameter(i.key(), i.value())){
+            qWarning("row %lld: invalid value of %s", row.number, qPrintable(i.key()));
+            isOk = false;
+        }
+    }
+
+    document.evaluateChanged();
+    if(document.isError()){
+        foreach (const QString &message, document.errors()) {
+            qWarning("row %lld: %s", row.number, qPrintable(message));
+        }
+        isOk = false;
+    }
+    if(!isOk){
+        return false;
+    }
+
+    const QString fname = outputFileName(row);
+    if(m_options.format == BatchOptions::Png){
+        return writePng(fname, document.toSvg());
+    }
+    return writeSvg(fname, document.toSvg());
+}
+
+/*!
+  * Get output file path: value of the name column or the row number
+  *
+  * \param[in] row parameter values
+  * \return path in the output directory
+  */
+QString BatchWorker::outputFileName(const BatchRow &row) const
+{
+    QString name = row.values.value(m_options.nameColumn).toString();
+    if(m_options.nameColumn.isEmpty() || name.isEmpty()){
+        name = QString("%1").arg(row.number, 6, 10, QLatin1Char('0'));
+    }
+    name.replace(QLatin1Char('/'), QLatin1Char('_'));
+    name.replace(QLatin1Char('\\'), QLatin1Char('_'));
+
+    const QString suffix = m_options.format == BatchOptions::Png ? ".png" : ".svg";
+    return QDir(m_options.outputDir).filePath(name + suffix);
+}
+
+bool BatchWorker::writeSvg(const QString &fname, const QByteArray &data)
+{
+    QFile file(fname);
+    if(!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()){
+        qWarning("Can not write %s", qPrintable(fname));
+        return false;
+    }
+    return true;
+}
+
+bool BatchWorker::writePng(const QString &fname, const QByteArray &data)
+{
+    QSvgRenderer renderer(data);
+    if(!renderer.isValid()){
+        qWarning("Invalid SVG for %s", qPrintable(fname));
+        return false;
+    }
+
+    const QSize size = m_options.size.isValid() ? m_options.size : renderer.defaultSize();
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    renderer.render(&painter);
+    painter.end();
+
+    if(!image.save(fname, "PNG")){
+        qWarning("Can not write %s", qPrintable(fname));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef BATCHWORKER_H
+#define BATCHWORKER_H
+
+
+#include <QAtomicInteger>
+#include <QThread>
+#include "batchrow.h"
+
+class ParametricSvgDocument;
+class RowQueue;
+
+class BatchWorker : public QThread
+{
+    Q_OBJECT
+private:
+    RowQueue *m_queue;
+    //Документ с загруженным шаблоном; только для чтения
+    const ParametricSvgDocument *m_probe;
+    BatchOptions m_options;
+    QAtomicInteger<qint64> m_rendered;
+    QAtomicInteger<qint64> m_failed;
+
+
+    //методы
+    bool renderRow(ParametricSvgDocument &document, const BatchRow &row);
+    QString outputFileName(const BatchRow &row) const;
+    bool writeSvg(const QString &fname, const QByteArray &data);
+    bool writePng(const QString &fname, const QByteArray &data);
+
+protected:
+    void run() override;
+
+public:
+    BatchWorker(RowQueue *queue, const ParametricSvgDocument *probe, const BatchOptions &options, QObject *parent = nullptr);
+
+    qint64 rendered() const;
+    qint64 failed() const;
+};
+
+#endif // BATCHWORKER_H
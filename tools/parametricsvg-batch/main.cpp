@@ -0,0 +1,141 @@
+#include "batchworker.h"
+#include "rowqueue.h"
+#include "rowreader.h"
+#include "parametricsvgdocument.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QGuiApplication>
+#include <QList>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    //Растеризация без оконной системы
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")){
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication a(argc, argv);
+    QGuiApplication::setApplicationName("parametricsvg-batch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render parameter sets from CSV or JSON lines into SVG or PNG files");
+    parser.addHelpOption();
+    parser.addPositionalArgument("template", "Parametric SVG file");
+    parser.addPositionalArgument("input", "CSV file with a header row or JSON lines file; - for stdin");
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Output directory", "dir", ".");
+    QCommandLineOption formatOption(QStringList() << "f" << "format", "Output format: svg or png", "format", "svg");
+    QCommandLineOption inputFormatOption("input-format", "Input format: csv or jsonl. By default from the file extension", "format");
+    QCommandLineOption nameOption("name-column", "Column with output file names. By default rows are numbered", "column");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Number of worker threads", "count",
+                                  QString::number(qMax(1, QThread::idealThreadCount())));
+    QCommandLineOption sizeOption("size", "Size of PNG images, e.g. 800x600. By default the size from SVG", "WxH");
+    QCommandLineOption namespaceOption("namespace", "Namespace prefix of parametric attributes", "name", "parametric");
+    parser.addOptions({ outputOption, formatOption, inputFormatOption, nameOption, jobsOption, sizeOption, namespaceOption });
+    parser.process(a);
+
+    const QStringList args = parser.positionalArguments();
+    if(args.size() != 2){
+        parser.showHelp(1);
+    }
+
+    BatchOptions options;
+    options.templateFile = args.at(0);
+    options.namespaceName = parser.value(namespaceOption);
+    options.outputDir = parser.value(outputOption);
+    options.nameColumn = parser.value(nameOption);
+
+    const QString format = parser.value(formatOption).toLower();
+    if(format == "png"){
+        options.format = BatchOptions::Png;
+    }else if(format != "svg"){
+        qCritical("Unknown output format %s", qPrintable(format));
+        return 1;
+    }
+
+    if(parser.isSet(sizeOption)){
+        const QStringList size = parser.value(sizeOption).split(QLatin1Char('x'));
+        if(size.size() == 2){
+            options.size = QSize(size.at(0).toInt(), size.at(1).toInt());
+        }
+        if(options.size.isEmpty()){
+            qCritical("Invalid size %s", qPrintable(parser.value(sizeOption)));
+            return 1;
+        }
+    }
+
+    bool ok;
+    const int jobs = parser.value(jobsOption).toInt(&ok);
+    if(!ok || jobs < 1){
+        qCritical("Invalid number of jobs %s", qPrintable(parser.value(jobsOption)));
+        return 1;
+    }
+
+    //Шаблон загружается один раз; потоки копируют документ
+    ParametricSvgDocument probe(options.namespaceName);
+    if(!probe.setContent(options.templateFile)){
+        qCritical("Can not load template %s", qPrintable(options.templateFile));
+        return 1;
+    }
+
+    if(!QDir().mkpath(options.outputDir)){
+        qCritical("Can not create output directory %s", qPrintable(options.outputDir));
+        return 1;
+    }
+
+    QFile input;
+    const QString inputName = args.at(1);
+    bool isInputOpen;
+    if(inputName == "-"){
+        isInputOpen = input.open(stdin, QIODevice::ReadOnly);
+    }else{
+        input.setFileName(inputName);
+        isInputOpen = input.open(QIODevice::ReadOnly);
+    }
+    if(!isInputOpen){
+        qCritical("Can not open %s", qPrintable(inputName));
+        return 1;
+    }
+
+    RowReader::Format inputFormat = RowReader::formatFromFileName(inputName);
+    if(parser.isSet(inputFormatOption)){
+        inputFormat = parser.value(inputFormatOption).toLower() == "csv" ? RowReader::Csv : RowReader::JsonLines;
+    }
+
+    //Очередь ограничена, поэтому память не зависит от числа строк
+    RowQueue queue(jobs * 64);
+    QList<BatchWorker *> workers;
+    for (int i = 0; i < jobs; ++i) {
+        BatchWorker *worker = new BatchWorker(&queue, &probe, options);
+        workers.append(worker);
+        worker->start();
+    }
+
+    RowReader reader(&input, inputFormat);
+    BatchRow row;
+    QString error;
+    qint64 skipped = 0;
+    while (reader.readRow(&row, &error)) {
+        if(!error.isEmpty()){
+            qWarning("line %lld: %s", reader.lineNumber(), qPrintable(error));
+            ++skipped;
+            continue;
+        }
+        queue.push(row);
+    }
+    queue.close();
+
+    qint64 rendered = 0;
+    qint64 failed = skipped;
+    foreach (BatchWorker *worker, workers) {
+        worker->wait();
+        rendered += worker->rendered();
+        failed += worker->failed();
+        delete worker;
+    }
+
+    QTextStream(stderr) << "Rendered: " << rendered << ", failed: " << failed << "\n";
+    return failed > 0 ? 2 : 0;
+}
@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Headless batch renderer of parametric SVG
+#
+#-------------------------------------------------
+
+QT       += core gui svg
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = parametricsvg-batch
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    batchworker.cpp \
+    rowqueue.cpp \
+    rowreader.cpp
+
+HEADERS  += batchworker.h \
+    batchrow.h \
+    rowqueue.h \
+    rowreader.h
+
+include(../../parametricsvgitem/parametricsvgdocument.pri)
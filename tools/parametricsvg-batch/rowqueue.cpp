@@ -0,0 +1,62 @@
+/*!
+ * \class RowQueue
+ * Bounded queue of input rows between the reader and worker threads.
+ * The reader is blocked while the queue is full, so memory does not
+ * depend on the number of rows.
+ */
+#include "rowqueue.h"
+
+RowQueue::RowQueue(int capacity):
+    m_capacity(qMax(1, capacity)),
+    m_isClosed(false)
+{
+}
+
+/*!
+  * Add row to the queue. Waits while the queue is full.
+  *
+  * \param[in] row parameter values
+  */
+void RowQueue::push(const BatchRow &row)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_rows.size() >= m_capacity && !m_isClosed) {
+        m_notFull.wait(&m_mutex);
+    }
+    if(m_isClosed){
+        return;
+    }
+    m_rows.enqueue(row);
+    m_notEmpty.wakeOne();
+}
+
+/*!
+  * Take row from the queue. Waits while the queue is empty and not closed.
+  *
+  * \param[out] row parameter values
+  * \return false, if the queue is closed and there are no more rows
+  */
+bool RowQueue::pop(BatchRow *row)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_rows.isEmpty() && !m_isClosed) {
+        m_notEmpty.wait(&m_mutex);
+    }
+    if(m_rows.isEmpty()){
+        return false;
+    }
+    *row = m_rows.dequeue();
+    m_notFull.wakeOne();
+    return true;
+}
+
+/*!
+  * Finish input. Workers take the remaining rows and stop.
+  */
+void RowQueue::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_isClosed = true;
+    m_notEmpty.wakeAll();
+    m_notFull.wakeAll();
+}
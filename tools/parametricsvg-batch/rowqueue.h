@@ -0,0 +1,28 @@
+#ifndef ROWQUEUE_H
+#define ROWQUEUE_H
+
+
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+#include "batchrow.h"
+
+class RowQueue
+{
+private:
+    QQueue<BatchRow> m_rows;
+    int m_capacity;
+    bool m_isClosed;
+    QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+
+public:
+    explicit RowQueue(int capacity);
+
+    void push(const BatchRow &row);
+    bool pop(BatchRow *row);
+    void close();
+};
+
+#endif // ROWQUEUE_H
@@ -0,0 +1,206 @@
+/*!
+ * \class RowReader
+ * Streaming reader of parameter sets: CSV with a header row
+ * or JSON lines with one object per line
+ */
+#include "rowreader.h"
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+
+RowReader::RowReader(QIODevice *device, RowReader::Format format):
+    m_stream(device),
+    m_format(format),
+    m_lineNumber(0),
+    m_rowNumber(0)
+{
+    m_stream.setCodec("UTF-8");
+}
+
+/*!
+  * Guess input format from file extension
+  *
+  * \param[in] fname input file name
+  * \return JsonLines for .jsonl, .ndjson and .json files, otherwise Csv
+  */
+RowReader::Format RowReader::formatFromFileName(const QString &fname)
+{
+    const QString lower = fname.toLower();
+    if(lower.endsWith(".jsonl") || lower.endsWith(".ndjson") || lower.endsWith(".json")){
+        return JsonLines;
+    }
+    return Csv;
+}
+
+/*!
+  * Read the next parameter set. Empty lines are skipped.
+  *
+  * \param[out] row number of the row and parameter values
+  * \param[out] error message, if the record is malformed. The record is skipped.
+  * \return false at the end of input
+  */
+bool RowReader::readRow(BatchRow *row, QString *error)
+{
+    error->clear();
+    row->values.clear();
+
+    if(m_format == JsonLines){
+        if(!readJsonRecord(&row->values, error)){
+            return false;
+        }
+        row->number = ++m_rowNumber;
+        return true;
+    }
+
+    QStringList fields;
+    if(m_header.isEmpty()){
+        if(!readCsvRecord(&m_header, error)){
+            return false;
+        }
+        for (int i = 0; i < m_header.size(); ++i) {
+            m_header[i] = m_header.at(i).trimmed();
+        }
+    }
+    if(!readCsvRecord(&fields, error)){
+        return false;
+    }
+    row->number = ++m_rowNumber;
+    if(error->isEmpty() && fields.size() != m_header.size()){
+        *error = QString("expected %1 fields, got %2").arg(m_header.size()).arg(fields.size());
+    }
+
+    for (int i = 0; i < fields.size() && i < m_header.size(); ++i) {
+        //Пустое поле оставляет значение по умолчанию
+        if(!fields.at(i).isEmpty()){
+            row->values.insert(m_header.at(i), csvFieldToValue(fields.at(i)));
+        }
+    }
+    return true;
+}
+
+/*!
+  * Get number of the last read line
+  *
+  * \return line number starting from 1
+  */
+qint64 RowReader::lineNumber() const
+{
+    return m_lineNumber;
+}
+
+/*!
+  * Read one CSV record. Quoted fields may contain separators,
+  * doubled quotes and line breaks.
+  *
+  * \param[out] fields values of fields
+  * \param[out] error message on unterminated quote
+  * \return false at the end of input
+  */
+bool RowReader::readCsvRecord(QStringList *fields, QString *error)
+{
+    fields->clear();
+
+    QString line;
+    do {
+        if(m_stream.atEnd()){
+            return false;
+        }
+        line = m_stream.readLine();
+        ++m_lineNumber;
+    } while (line.trimmed().isEmpty());
+
+    QString field;
+    bool isQuoted = false;
+    int i = 0;
+    while (true) {
+        if(i >= line.size()){
+            if(!isQuoted){
+                break;
+            }
+            //Перевод строки внутри кавычек
+            if(m_stream.atEnd()){
+                *error = QString("unterminated quote");
+                break;
+            }
+            field.append(QLatin1Char('\n'));
+            line = m_stream.readLine();
+            ++m_lineNumber;
+            i = 0;
+            continue;
+        }
+
+        const QChar c = line.at(i);
+        if(isQuoted){
+            if(c == QLatin1Char('"')){
+                if(i + 1 < line.size() && line.at(i + 1) == QLatin1Char('"')){
+                    field.append(c);
+                    ++i;
+                }else{
+                    isQuoted = false;
+                }
+            }else{
+                field.append(c);
+            }
+        }else if(c == QLatin1Char('"')){
+            isQuoted = true;
+        }else if(c == QLatin1Char(',')){
+            fields->append(field);
+            field.clear();
+        }else{
+            field.append(c);
+        }
+        ++i;
+    }
+    fields->append(field);
+    return true;
+}
+
+/*!
+  * Read one JSON object
+  *
+  * \param[out] values members of the object
+  * \param[out] error message, if the line is not a JSON object
+  * \return false at the end of input
+  */
+bool RowReader::readJsonRecord(QVariantMap *values, QString *error)
+{
+    QString line;
+    do {
+        if(m_stream.atEnd()){
+            return false;
+        }
+        line = m_stream.readLine();
+        ++m_lineNumber;
+    } while (line.trimmed().isEmpty());
+
+    QJsonParseError parseError;
+    QJsonDocument json = QJsonDocument::fromJson(line.toUtf8(), &parseError);
+    if(parseError.error != QJsonParseError::NoError){
+        *error = parseError.errorString();
+        return true;
+    }
+    if(!json.isObject()){
+        *error = QString("not a JSON object");
+        return true;
+    }
+    *values = json.object().toVariantMap();
+    return true;
+}
+
+/*!
+  * Convert CSV field to parameter value, as values are read from SVG:
+  * a number, if the field is a number, otherwise a string
+  *
+  * \param[in] field CSV field
+  * \return value
+  */
+QVariant RowReader::csvFieldToValue(const QString &field)
+{
+    bool ok;
+    double value = field.trimmed().toDouble(&ok);
+    if(ok){
+        return QVariant(value);
+    }
+    return QVariant(field);
+}
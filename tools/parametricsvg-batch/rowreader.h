@@ -0,0 +1,42 @@
+#ifndef ROWREADER_H
+#define ROWREADER_H
+
+
+#include <QStringList>
+#include <QTextStream>
+#include "batchrow.h"
+
+class QIODevice;
+
+class RowReader
+{
+public:
+    enum Format {
+        Csv,
+        JsonLines
+    };
+
+private:
+    QTextStream m_stream;
+    Format m_format;
+    //Заголовок CSV: имена параметров
+    QStringList m_header;
+    qint64 m_lineNumber;
+    qint64 m_rowNumber;
+
+
+    //методы
+    bool readCsvRecord(QStringList *fields, QString *error);
+    bool readJsonRecord(QVariantMap *values, QString *error);
+    static QVariant csvFieldToValue(const QString &field);
+
+public:
+    RowReader(QIODevice *device, Format format);
+
+    bool readRow(BatchRow *row, QString *error);
+    qint64 lineNumber() const;
+
+    static Format formatFromFileName(const QString &fname);
+};
+
+#endif // ROWREADER_H
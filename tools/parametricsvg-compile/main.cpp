@@ -0,0 +1,56 @@
+#include "parametricsvgtemplate.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("parametricsvg-compile");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compile parametric SVG files into binary templates loaded without XML parsing");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Parametric SVG files", "files...");
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Output file for a single input. By default .psvgc next to the SVG file,"
+                                    " where it is found by the item", "file");
+    QCommandLineOption namespaceOption("namespace", "Namespace prefix of parametric attributes", "name", "parametric");
+    parser.addOptions({ outputOption, namespaceOption });
+    parser.process(a);
+
+    const QStringList files = parser.positionalArguments();
+    if(files.isEmpty()){
+        parser.showHelp(1);
+    }
+    if(parser.isSet(outputOption) && files.size() != 1){
+        qCritical("Output file can be set only for a single input");
+        return 1;
+    }
+
+    int failed = 0;
+    foreach (const QString &fname, files) {
+        const QString output = parser.isSet(outputOption)
+                ? parser.value(outputOption)
+                : ParametricSvgTemplate::compiledFileName(fname);
+
+        //Устаревший скомпилированный шаблон не используется при загрузке SVG
+        QSharedPointer<const ParametricSvgTemplate> svgTemplate =
+                ParametricSvgTemplate::load(fname, parser.value(namespaceOption));
+        if(svgTemplate.isNull()){
+            qCritical("Can not load %s", qPrintable(fname));
+            ++failed;
+            continue;
+        }
+        if(!svgTemplate->saveCompiled(output)){
+            qCritical("Can not write %s", qPrintable(output));
+            ++failed;
+            continue;
+        }
+        QTextStream(stdout) << fname << " -> " << output << "\n";
+    }
+
+    return failed > 0 ? 2 : 0;
+}
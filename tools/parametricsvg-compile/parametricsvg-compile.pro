@@ -0,0 +1,18 @@
+#-------------------------------------------------
+#
+# Compiler of parametric SVG into binary templates
+#
+#-------------------------------------------------
+
+QT       += core
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = parametricsvg-compile
+TEMPLATE = app
+
+
+SOURCES += main.cpp
+
+include(../../parametricsvgitem/parametricsvgdocument.pri)